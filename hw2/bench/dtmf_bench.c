@@ -0,0 +1,279 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "const.h"
+#include "dtmf_options.h"
+#include "audio.h"
+#include "audio_bulk.h"
+
+/*
+ * Benchmark and accuracy sweep for DTMF detection.
+ *
+ * For each class of tone duration, a random list of events is drawn and audio of
+ * the requested length is synthesized from it with dtmf_generate(), without noise
+ * and at each of a range of noise levels (as with -l).  Each of these is then
+ * analyzed with dtmf_detect() at each of a range of block sizes, and one line is
+ * reported for each combination:
+ *
+ *   level    the noise level in dB, or "none"
+ *   msec     the nominal duration of the tones (each is within 20% of it)
+ *   block    the block size
+ *   Msamp/s  millions of samples analyzed per second of CPU time
+ *   recall   percentage of the generated events that were detected
+ *   prec     percentage of the detected events that were generated
+ *   start    mean error (in ms) of the start of the events detected
+ *   end      mean error (in ms) of their end
+ *
+ * A detected event counts as a generated one if it has the same symbol and the two
+ * overlap; each generated event is matched at most once.  The noise is white, with
+ * the same RMS level as the tones, so a level of 0 dB mixes them in equal parts.
+ *
+ * Usage: dtmf_bench [-m MINUTES] [-S SEED] [-f]
+ *   -m MINUTES  length of the audio synthesized for each tone duration (default 15)
+ *   -S SEED     seed for the random event lists (default 1)
+ *   -f          analyze with the fixed-point filters (--fixed)
+ */
+
+#define BENCH_GAP_MIN_MS 40
+#define BENCH_GAP_MAX_MS 300
+
+static int durations[] = {40, 60, 100, 250};
+static int levels[] = {-30, -20, -10, 0};
+static int block_sizes[] = {10, 25, 50, 100, 160, 205, 256, 400, 1000};
+
+#define NELEM(a) (sizeof(a) / sizeof((a)[0]))
+
+typedef struct bench_event {
+	uint32_t start;
+	uint32_t end;
+	char symbol;
+	int matched;
+} BENCH_EVENT;
+
+static uint64_t rng_state;
+
+static uint32_t rng_next(void) {
+	// xorshift64*
+	rng_state ^= rng_state >> 12;
+	rng_state ^= rng_state << 25;
+	rng_state ^= rng_state >> 27;
+	return (uint32_t)((rng_state * 2685821657736338717ULL) >> 32);
+}
+
+static uint32_t rng_range(uint32_t lo, uint32_t hi) {
+	return lo + rng_next() % (hi - lo + 1);
+}
+
+static double cpu_seconds(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Draw events of about the given duration, separated by random gaps, to fill
+ * length samples.
+ */
+static BENCH_EVENT *make_events(int msec, uint32_t length, size_t *np) {
+	static const char symbols[] = "0123456789ABCD*#";
+	size_t capacity = length / (AUDIO_FRAME_RATE * (msec + BENCH_GAP_MIN_MS) / 1000) + 1;
+	BENCH_EVENT *events = malloc(capacity * sizeof(BENCH_EVENT));
+	size_t n = 0;
+	uint32_t i = rng_range(BENCH_GAP_MIN_MS, BENCH_GAP_MAX_MS) * (AUDIO_FRAME_RATE / 1000);
+	while (events && n < capacity) {
+		uint32_t len = rng_range(msec * 8 / 10, msec * 12 / 10) * (AUDIO_FRAME_RATE / 1000);
+		if (i + len > length) {
+			break;
+		}
+		events[n].start = i;
+		events[n].end = i + len;
+		events[n].symbol = symbols[rng_next() % 16];
+		events[n].matched = 0;
+		n++;
+		i += len + rng_range(BENCH_GAP_MIN_MS, BENCH_GAP_MAX_MS) * (AUDIO_FRAME_RATE / 1000);
+	}
+	*np = n;
+	return events;
+}
+
+static char *events_text(BENCH_EVENT *events, size_t n, size_t *lenp) {
+	char *text;
+	FILE *f = open_memstream(&text, lenp);
+	for (size_t e = 0; e < n; e++) {
+		fprintf(f, "%u\t%u\t%c\n", events[e].start, events[e].end, events[e].symbol);
+	}
+	fclose(f);
+	return text;
+}
+
+/*
+ * Write a file of uniform white noise with the RMS level of a DTMF tone.
+ */
+static int make_noise(char *path, uint32_t length) {
+	FILE *f = fopen(path, "w");
+	if (!f) {
+		return EOF;
+	}
+	AUDIO_HEADER header = {AUDIO_MAGIC, AUDIO_DATA_OFFSET, length * 2, PCM16_ENCODING,
+			       AUDIO_FRAME_RATE, 1};
+	int ret = audio_write_header(f, &header);
+	int16_t samples[AUDIO_BULK_CHUNK];
+	for (uint32_t i = 0; ret == 0 && i < length; i += AUDIO_BULK_CHUNK) {
+		uint32_t n = length - i < AUDIO_BULK_CHUNK ? length - i : AUDIO_BULK_CHUNK;
+		for (uint32_t k = 0; k < n; k++) {
+			// Uniform on [-A, A] has RMS A / sqrt(3); a tone has INT16_MAX / 2.
+			samples[k] = (int16_t)((int32_t)(rng_next() % 56755) - 28377);
+		}
+		ret = audio_write_samples(f, samples, n);
+	}
+	if (fclose(f) == EOF) {
+		ret = EOF;
+	}
+	return ret;
+}
+
+/*
+ * Synthesize the audio for a list of events, with the noise level currently set.
+ */
+static char *generate(char *text, size_t text_len, uint32_t length, size_t *lenp) {
+	char *audio;
+	FILE *in = fmemopen(text, text_len, "r");
+	FILE *out = open_memstream(&audio, lenp);
+	int ret = dtmf_generate(in, out, length);
+	fclose(in);
+	fclose(out);
+	if (ret == EOF) {
+		free(audio);
+		return NULL;
+	}
+	return audio;
+}
+
+/*
+ * Analyze audio with the block size currently set, then score the events detected
+ * against those generated and report the result.
+ */
+static int detect(char *audio, size_t audio_len, uint32_t length, BENCH_EVENT *truth,
+		  size_t ntruth, char *level, int msec) {
+	char *text;
+	size_t text_len;
+	FILE *in = fmemopen(audio, audio_len, "r");
+	FILE *out = open_memstream(&text, &text_len);
+	double t0 = cpu_seconds();
+	int ret = dtmf_detect(in, out);
+	double elapsed = cpu_seconds() - t0;
+	fclose(in);
+	fclose(out);
+	if (ret == EOF) {
+		free(text);
+		return EOF;
+	}
+
+	for (size_t e = 0; e < ntruth; e++) {
+		truth[e].matched = 0;
+	}
+	size_t ndetected = 0, nmatched = 0, first = 0;
+	double start_err = 0, end_err = 0;
+	uint32_t start, end;
+	char symbol;
+	int offset = 0, consumed;
+	while (sscanf(text + offset, "%u\t%u\t%c\n%n", &start, &end, &symbol, &consumed) == 3) {
+		offset += consumed;
+		ndetected++;
+		// Both lists are in order, so earlier generated events cannot overlap this one.
+		while (first < ntruth && truth[first].end <= start) {
+			first++;
+		}
+		for (size_t e = first; e < ntruth && truth[e].start < end; e++) {
+			if (!truth[e].matched && truth[e].symbol == symbol) {
+				truth[e].matched = 1;
+				nmatched++;
+				start_err += abs((int)start - (int)truth[e].start);
+				end_err += abs((int)end - (int)truth[e].end);
+				break;
+			}
+		}
+	}
+	free(text);
+
+	double ms = 1000.0 / AUDIO_FRAME_RATE / (nmatched ? nmatched : 1);
+	printf("%6s %5d %6d %9.1f %7.1f %7.1f %7.2f %7.2f\n", level, msec, block_size,
+	       length / elapsed / 1e6, ntruth ? 100.0 * nmatched / ntruth : 100.0,
+	       ndetected ? 100.0 * nmatched / ndetected : 100.0, start_err * ms, end_err * ms);
+	fflush(stdout);
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int minutes = 15, opt;
+	rng_state = 1;
+	while ((opt = getopt(argc, argv, "m:S:f")) != -1) {
+		switch (opt) {
+		case 'm':
+			minutes = atoi(optarg);
+			break;
+		case 'S':
+			rng_state = strtoull(optarg, NULL, 10);
+			break;
+		case 'f':
+			fixed_point = 1;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-m MINUTES] [-S SEED] [-f]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+	}
+	if (minutes < 1 || minutes > 240 || rng_state == 0) {
+		fprintf(stderr, "%s: MINUTES must be in [1, 240] and SEED nonzero\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	uint32_t length = minutes * 60 * AUDIO_FRAME_RATE;
+
+	char noise_path[] = "/tmp/dtmf_bench_noise_XXXXXX";
+	int fd = mkstemp(noise_path);
+	if (fd != -1) {
+		close(fd);
+	}
+	if (fd == -1 || make_noise(noise_path, length) == EOF) {
+		fprintf(stderr, "%s: cannot write noise file\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	int status = EXIT_SUCCESS;
+	printf("%6s %5s %6s %9s %7s %7s %7s %7s\n", "level", "msec", "block", "Msamp/s",
+	       "recall", "prec", "start", "end");
+	for (size_t d = 0; d < NELEM(durations) && status == EXIT_SUCCESS; d++) {
+		size_t ntruth, text_len;
+		BENCH_EVENT *truth = make_events(durations[d], length, &ntruth);
+		char *text = truth ? events_text(truth, ntruth, &text_len) : NULL;
+		for (int l = -1; text && l < (int)NELEM(levels) && status == EXIT_SUCCESS; l++) {
+			char level[16] = "none";
+			noise_file = NULL;
+			noise_level = 0;
+			if (l >= 0) {
+				noise_file = noise_path;
+				noise_level = levels[l];
+				snprintf(level, sizeof(level), "%d", levels[l]);
+			}
+			size_t audio_len;
+			char *audio = generate(text, text_len, length, &audio_len);
+			int ret = audio ? 0 : EOF;
+			for (size_t b = 0; ret == 0 && b < NELEM(block_sizes); b++) {
+				block_size = hop_size = block_sizes[b];
+				ret = detect(audio, audio_len, length, truth, ntruth, level, durations[d]);
+			}
+			if (ret == EOF) {
+				fprintf(stderr, "%s: generation or detection failed\n", argv[0]);
+				status = EXIT_FAILURE;
+			}
+			free(audio);
+		}
+		free(text);
+		free(truth);
+	}
+	unlink(noise_path);
+	return status;
+}
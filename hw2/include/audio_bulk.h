@@ -0,0 +1,148 @@
+#ifndef AUDIO_BULK_H
+#define AUDIO_BULK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "audio.h"
+#include "audio_g711.h"
+
+/*
+ * Block-oriented counterparts of audio_read_sample() and audio_write_sample().
+ * Rather than making two stdio calls per sample, these functions transfer a whole
+ * array of samples with a single fread() or fwrite() and convert between the
+ * big-endian byte order used in the file and the host byte order with a
+ * vectorized byte-swap kernel.
+ */
+
+/*
+ * Number of samples transferred by a single call to fwrite() in audio_write_samples().
+ */
+#define AUDIO_BULK_CHUNK 4096
+
+/*
+ * Largest number of channels accepted by audio_decode_header() in audio that is read.
+ * Audio that is created is always monaural (AUDIO_CHANNELS).
+ */
+#define AUDIO_MAX_CHANNELS 16
+
+/**
+ * Read up to n two-byte audio samples from an input stream.
+ *
+ *   @param in  Input stream from which samples are to be read.
+ *   @param samples  Array into which to store the sample values, in host byte order.
+ *   @param n  Maximum number of samples to be read.
+ *   @return  The number of complete samples read, which is less than n only if
+ *   EOF or an error was encountered.
+ */
+size_t audio_read_samples(FILE *in, int16_t *samples, size_t n);
+
+/**
+ * Write n two-byte audio samples to an output stream.
+ *
+ *   @param out  Output stream to which samples are to be written.
+ *   @param samples  Array of samples to be written, in host byte order.
+ *   @param n  Number of samples to be written.
+ *   @return 0 on success, EOF otherwise.
+ */
+int audio_write_samples(FILE *out, int16_t *samples, size_t n);
+
+/**
+ * Write n two-byte audio samples to a file at a given offset, with pwrite(), so that
+ * several threads may write different parts of the same file.
+ *
+ *   @param fd  Descriptor of the file to which samples are to be written.
+ *   @param samples  Array of samples to be written, in host byte order.
+ *   @param n  Number of samples to be written.
+ *   @param offset  Offset in the file at which the first sample is to be written.
+ *   @return 0 on success, EOF otherwise.
+ */
+int audio_pwrite_samples(int fd, int16_t *samples, size_t n, off_t offset);
+
+/**
+ * Convert between big-endian and host byte order.  The source and destination
+ * may be the same array.
+ *
+ *   @param src  Array of n samples to be converted.
+ *   @param dst  Array to receive the n converted samples.
+ *   @param n  Number of samples.
+ */
+void audio_swap_samples(int16_t *src, int16_t *dst, size_t n);
+
+/**
+ * Scale samples to the range [-1.0, 1.0] by dividing by INT16_MAX, as is done
+ * before samples are given to the Goertzel filters.
+ *
+ *   @param samples  Array of n samples, in host byte order.
+ *   @param x  Array to receive the n scaled values.
+ *   @param n  Number of samples.
+ */
+void audio_normalize_samples(int16_t *samples, double *x, size_t n);
+
+/**
+ * Decode and validate an audio header held in memory, as audio_read_header()
+ * does for a header read from a stream.
+ *
+ *   @param bytes  The AUDIO_DATA_OFFSET bytes of the header, as found in the file.
+ *   @param hp  Pointer to the header structure to be filled in.
+ *   @return 0 if the header is valid, EOF otherwise.
+ */
+int audio_decode_header(uint8_t *bytes, AUDIO_HEADER *hp);
+
+/**
+ * Convert samples held in memory in the byte order of the file (big-endian) to
+ * host byte order.  Unlike audio_swap_samples(), the source need not be aligned.
+ *
+ *   @param src  The 2 * n bytes of the samples.
+ *   @param dst  Array to receive the n samples.
+ *   @param n  Number of samples.
+ */
+void audio_decode_samples(uint8_t *src, int16_t *dst, size_t n);
+
+/**
+ * The same as audio_normalize_samples(), for samples held in memory in the byte
+ * order of the file, which need not be aligned.
+ */
+void audio_normalize_be_samples(uint8_t *src, double *x, size_t n);
+
+/*
+ * Counterparts of the functions above for samples in any of the encodings that can
+ * be read: PCM16_ENCODING, MULAW_ENCODING and ALAW_ENCODING.  Samples in the 8-bit
+ * encodings are decoded by table lookup, with the same results as if the file had
+ * first been converted to PCM16_ENCODING.
+ */
+
+/**
+ * Number of bytes occupied by a sample in an encoding.
+ *
+ *   @param encoding  The encoding field of an audio header.
+ *   @return  The number of bytes, or 0 if the encoding is not supported.
+ */
+size_t audio_encoding_bytes(uint32_t encoding);
+
+/**
+ * Read up to n audio samples in a given encoding from an input stream.
+ *
+ *   @param in  Input stream from which samples are to be read.
+ *   @param encoding  Encoding of the samples.
+ *   @param samples  Array into which to store the decoded samples.
+ *   @param n  Maximum number of samples to be read.
+ *   @return  The number of complete samples read, which is less than n only if
+ *   EOF or an error was encountered.
+ */
+size_t audio_read_encoded(FILE *in, uint32_t encoding, int16_t *samples, size_t n);
+
+/**
+ * Decode samples in a given encoding held in memory, as audio_decode_samples()
+ * does for PCM16_ENCODING.
+ */
+void audio_decode_encoded(uint8_t *src, uint32_t encoding, int16_t *dst, size_t n);
+
+/**
+ * Decode and scale samples in a given encoding held in memory, as
+ * audio_normalize_be_samples() does for PCM16_ENCODING.
+ */
+void audio_normalize_encoded(uint8_t *src, uint32_t encoding, double *x, size_t n);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef AUDIO_G711_H
+#define AUDIO_G711_H
+
+#include <stdint.h>
+
+/*
+ * The 8-bit logarithmic encodings of telephone audio defined by ITU-T G.711, which
+ * may be used in an audio file in place of PCM16_ENCODING.  Each sample occupies one
+ * byte, and is decoded to a 16-bit linear sample by looking it up in a table.
+ */
+
+#define MULAW_ENCODING (1)
+#define ALAW_ENCODING (27)
+
+/*
+ * The linear sample corresponding to each mu-law and each A-law code.
+ */
+extern const int16_t audio_mulaw_table[256];
+extern const int16_t audio_alaw_table[256];
+
+#endif
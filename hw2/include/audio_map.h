@@ -0,0 +1,56 @@
+#ifndef AUDIO_MAP_H
+#define AUDIO_MAP_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "audio.h"
+
+/*
+ * An audio source that maps an audio file into memory instead of reading it.
+ * The header is decoded where it lies, the annotation field is passed over simply
+ * by taking the address at data_offset, and the sample data is then available, in
+ * the big-endian byte order of the file, without being copied at all.
+ *
+ * Only a regular file can be mapped; for anything else (a pipe or terminal, say)
+ * audio_map_open() fails and the stream should be read as usual.
+ */
+typedef struct audio_map {
+    uint8_t *base;       // Start of the mapping of the whole file.
+    size_t length;       // Length of the mapping.
+    off_t start;         // Offset in the file at which the audio (its header) starts.
+    uint8_t *data;       // First byte of the sample data, once the header has been read.
+    size_t nsamples;     // Number of complete samples in the sample data.
+    uint32_t encoding;   // Encoding of the samples.
+} AUDIO_MAP;
+
+/*
+ * Map the file underlying an input stream.  The audio is taken to begin at the
+ * current position of the stream, as it would be if it were read from the stream.
+ *
+ *   @param mp  The audio source to be set up.
+ *   @param in  The input stream.
+ *   @return 0 if successful, EOF if the stream is not a regular file or could not
+ *   be mapped.
+ */
+int audio_map_open(AUDIO_MAP *mp, FILE *in);
+
+/*
+ * Decode and validate the header of a mapped audio file, with the same result as
+ * audio_read_header() would have for the same file, and locate the sample data.
+ * As when reading, the sample data extends to the end of the file, whatever the
+ * data_size field may say.
+ *
+ *   @param mp  The audio source.
+ *   @param hp  Pointer to the header structure to be filled in.
+ *   @return 0 if the header is valid and complete, EOF otherwise.
+ */
+int audio_map_read_header(AUDIO_MAP *mp, AUDIO_HEADER *hp);
+
+/*
+ * Unmap a mapped audio file.  The stream it was opened from is not affected.
+ */
+void audio_map_close(AUDIO_MAP *mp);
+
+#endif
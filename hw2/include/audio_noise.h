@@ -0,0 +1,166 @@
+#ifndef AUDIO_NOISE_H
+#define AUDIO_NOISE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "audio_bulk.h"
+
+/*
+ * Noise to be mixed into generated audio, and the mixer that does so.
+ *
+ * The samples of a noise file are decoded into memory once, mapping the file if
+ * possible, and are kept there: if the same file is asked for again while it is
+ * unchanged (as when several outputs are generated with one noise file in one
+ * process), the decoded samples are reused rather than read again.
+ *
+ * The mixer collects generated samples in a buffer and, a buffer at a time, mixes
+ * them with the noise, converts them to integers and writes them with
+ * audio_write_samples().  A sample x that is mixed with noise sample y, using
+ * noise weight w, becomes
+ *
+ *   (int16_t)(int)(x * (1 - w) + y * w),
+ *
+ * the noise being taken as zero once the noise file is exhausted.  Without noise
+ * the sample becomes (int16_t)x, and samples that are already integers may be given
+ * to the mixer directly.
+ */
+
+/*
+ * The decoded samples of a noise file.
+ */
+typedef struct audio_noise {
+    int16_t *samples;    // The samples, in host byte order.
+    size_t nsamples;     // Number of samples.
+    dev_t dev;           // Identity of the file, to recognize it if asked for again.
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+    int cached;          // Nonzero if the samples are held for reuse.
+} AUDIO_NOISE;
+
+/*
+ * Obtain the samples of a noise file.
+ *
+ *   @param path  Name of the noise file.
+ *   @return  The samples of the file, or NULL if the file could not be opened or
+ *   does not hold valid audio.
+ */
+AUDIO_NOISE *audio_noise_open(char *path);
+
+/*
+ * Give up samples obtained from audio_noise_open().  Samples held for reuse are
+ * kept until a different noise file is opened.
+ */
+void audio_noise_close(AUDIO_NOISE *np);
+
+/*
+ * Mix samples with noise and convert them to integers, as described above.
+ *
+ *   @param x  Array of n samples to be mixed.
+ *   @param noise  Array of the n noise samples, or NULL to mix with silence.
+ *   @param n  Number of samples.
+ *   @param w  Weight of the noise.
+ *   @param out  Array to receive the n mixed samples.
+ */
+void audio_noise_mix(double *x, int16_t *noise, size_t n, double w, int16_t *out);
+
+/*
+ * Mixer that writes generated samples, mixed with noise, to an output stream.
+ */
+typedef struct audio_mixer {
+    FILE *out;                            // Stream to which samples are written, or NULL.
+    int fd;                               // Otherwise, file to which they are written.
+    off_t offset;                         // Offset in that file of sample 0.
+    AUDIO_NOISE *noise;                   // The noise, or NULL if there is none.
+    int owns_noise;                       // Nonzero if the noise was opened by the mixer.
+    double w;                             // Weight of the noise.
+    size_t position;                      // Index of the first sample in the buffer.
+    size_t count;                         // Number of samples in the buffer.
+    double samples[AUDIO_BULK_CHUNK];     // Samples to be mixed with noise.
+    int16_t mixed[AUDIO_BULK_CHUNK];      // Samples as written (without noise, as committed).
+} AUDIO_MIXER;
+
+/*
+ * Set up a mixer.
+ *
+ *   @param mp  The mixer.
+ *   @param out  Stream to which samples are to be written.
+ *   @param noise_path  Name of the noise file, or NULL for no noise.
+ *   @param w  Weight of the noise.
+ *   @return 0 if successful, EOF if the noise file could not be opened.
+ */
+int audio_mixer_init(AUDIO_MIXER *mp, FILE *out, char *noise_path, double w);
+
+/*
+ * Set up a mixer that writes the samples from a given index onwards to their places
+ * in a file, with audio_pwrite_samples().  Mixers for different ranges of samples
+ * may then be used by different threads.
+ *
+ *   @param mp  The mixer.
+ *   @param fd  Descriptor of the file to which samples are to be written.
+ *   @param offset  Offset in the file of sample 0.
+ *   @param noise  The noise, or NULL for no noise.  It is shared, not released.
+ *   @param w  Weight of the noise.
+ *   @param position  Index of the first sample to be written.
+ */
+void audio_mixer_init_at(AUDIO_MIXER *mp, int fd, off_t offset, AUDIO_NOISE *noise,
+			 double w, size_t position);
+
+/*
+ * Obtain space in the buffer for samples to be written.
+ *
+ *   @param mp  The mixer.
+ *   @param room  Set to the number of samples that fit in the space, at least one.
+ *   @return  The space, into which the samples (before conversion to integers) are
+ *   to be stored before they are added with audio_mixer_commit().
+ */
+double *audio_mixer_space(AUDIO_MIXER *mp, size_t *room);
+
+/*
+ * Add samples stored in the space obtained from audio_mixer_space() to those to be
+ * written, writing the buffer if it becomes full.
+ *
+ *   @param mp  The mixer.
+ *   @param n  Number of samples stored, no more than the room in the space.
+ *   @return 0 if successful, EOF if an error occurred in writing.
+ */
+int audio_mixer_commit(AUDIO_MIXER *mp, size_t n);
+
+/*
+ * Obtain space in the buffer of a mixer without noise for samples that are already
+ * integers, which are stored as they are.
+ *
+ *   @param mp  The mixer, which must have no noise.
+ *   @param room  Set to the number of samples that fit in the space, at least one.
+ *   @return  The space, into which the samples are to be stored before they are
+ *   added with audio_mixer_commit_pcm().
+ */
+int16_t *audio_mixer_pcm_space(AUDIO_MIXER *mp, size_t *room);
+
+/*
+ * Add samples stored in the space obtained from audio_mixer_pcm_space() to those to
+ * be written, writing the buffer if it becomes full.
+ *
+ *   @param mp  The mixer.
+ *   @param n  Number of samples stored, no more than the room in the space.
+ *   @return 0 if successful, EOF if an error occurred in writing.
+ */
+int audio_mixer_commit_pcm(AUDIO_MIXER *mp, size_t n);
+
+/*
+ * Write any samples remaining in the buffer.
+ *
+ *   @param mp  The mixer.
+ *   @return 0 if successful, EOF if an error occurred in writing.
+ */
+int audio_mixer_flush(AUDIO_MIXER *mp);
+
+/*
+ * Release the noise used by a mixer.  Samples not yet written are discarded.
+ */
+void audio_mixer_fini(AUDIO_MIXER *mp);
+
+#endif
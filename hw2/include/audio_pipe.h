@@ -0,0 +1,90 @@
+#ifndef AUDIO_PIPE_H
+#define AUDIO_PIPE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * An audio source that reads the sample data of a stream on a thread of its own,
+ * so that reading (from slow storage, or from a pipe fed by another program) and
+ * analyzing the samples overlap instead of taking turns.
+ *
+ * The reader thread fills a ring of buffers with large fread() calls, and the
+ * consumer takes the buffers in order, each holding the bytes of the samples just as
+ * they are in the file.  At most depth buffers are in the ring at once: when all of
+ * them are full the reader waits for the consumer to release one, and when all of
+ * them are empty the consumer waits for the reader.  Each of these waits is counted,
+ * so that it can be seen which side holds the other up.
+ */
+
+/*
+ * Default number of bytes in each buffer, rounded down to a whole number of frames.
+ */
+#define AUDIO_PIPE_BUFFER (256 * 1024)
+
+/*
+ * Range of the number of buffers in the ring.
+ */
+#define AUDIO_PIPE_MIN_DEPTH 2
+#define AUDIO_PIPE_MAX_DEPTH 64
+
+typedef struct audio_pipe {
+    FILE *in;                    // Stream from which the samples are read.
+    size_t buffer_size;          // Number of bytes in each buffer.
+    int depth;                   // Number of buffers in the ring.
+    uint8_t **buffers;           // The buffers.
+    size_t *lengths;             // Number of bytes read into each full buffer.
+    int head;                    // Index of the next buffer to be filled.
+    int tail;                    // Index of the next buffer to be consumed.
+    int count;                   // Number of full buffers, including one being consumed.
+    int holding;                 // Nonzero while the consumer holds the buffer at tail.
+    int eof;                     // Nonzero once the reader has reached EOF (or an error).
+    int stop;                    // Nonzero once the reader is to stop early.
+    uint64_t bytes;              // Total number of bytes read.
+    uint32_t reads;              // Number of buffers filled.
+    uint32_t reader_stalls;      // Times the reader found every buffer full.
+    uint32_t consumer_stalls;    // Times the consumer found every buffer empty.
+    pthread_t reader;
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;       // Signaled when a buffer is filled, or at EOF.
+    pthread_cond_t released;     // Signaled when a buffer is released, or on stop.
+} AUDIO_PIPE;
+
+/*
+ * Start reading a stream on a new thread.  Everything from the current position of
+ * the stream to EOF is read, so the header should already have been read from it.
+ *
+ *   @param in  The input stream, which must not be used by anything else until the
+ *   pipe is closed.
+ *   @param frame_bytes  Number of bytes in each frame (a sample of every channel);
+ *   each buffer but the last holds a whole number of frames.
+ *   @param depth  Number of buffers, in the range [AUDIO_PIPE_MIN_DEPTH,
+ *   AUDIO_PIPE_MAX_DEPTH].
+ *   @return  The pipe, or NULL if the depth is out of range or storage or the thread
+ *   could not be obtained.
+ */
+AUDIO_PIPE *audio_pipe_open(FILE *in, size_t frame_bytes, int depth);
+
+/*
+ * Obtain the next buffer of bytes read, first releasing the one previously
+ * obtained, which may then be filled again.  This waits for the reader if it has not
+ * yet filled the buffer.
+ *
+ *   @param pp  The pipe.
+ *   @param datap  Set to the start of the bytes.
+ *   @return  The number of bytes in the buffer, or 0 once everything has been read.
+ */
+size_t audio_pipe_next(AUDIO_PIPE *pp, uint8_t **datap);
+
+/*
+ * Stop the reader, if it has not yet reached EOF, wait for it to finish and free
+ * the pipe.  The input stream is not closed.
+ *
+ *   @param pp  The pipe.
+ *   @param report  Stream to which the number of bytes read and the number of times
+ *   each side waited for the other are written, on one line, or NULL for none.
+ */
+void audio_pipe_close(AUDIO_PIPE *pp, FILE *report);
+
+#endif
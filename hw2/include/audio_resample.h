@@ -0,0 +1,104 @@
+#ifndef AUDIO_RESAMPLE_H
+#define AUDIO_RESAMPLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ * Conversion of audio recorded at a higher sample rate (16 kHz, 44.1 kHz and so on)
+ * to AUDIO_FRAME_RATE, so that it can be analyzed by filters designed for that rate.
+ *
+ * The rate is changed by the rational factor L / M (for 44100 Hz, 80 / 441): the
+ * input is notionally upsampled by L, low-pass filtered and downsampled by M.  The
+ * filter is stored in polyphase form, as L sets of RESAMPLE taps, so each output
+ * sample is a single dot product of one set of taps with the most recent input
+ * samples, computed with vector instructions, and no work is done for the samples
+ * that upsampling inserts or downsampling discards.
+ *
+ * The filter is a Blackman-windowed sinc with its cutoff at half the output rate
+ * and a transition band DECIMATOR_TRANSITION Hz wide, so DTMF frequencies pass
+ * unchanged while anything that would alias into the band below 3400 Hz is
+ * attenuated by some 70 dB.  The output is aligned with the input: output sample m
+ * stands for the instant of input sample m * M / L, the filter looking ahead of that
+ * instant as far as it looks behind.
+ *
+ * Audio that is created is always at AUDIO_FRAME_RATE, but audio that is read may
+ * have any higher rate up to DECIMATOR_MAX_RATE for which L, with the factor in
+ * lowest terms, is no larger than DECIMATOR_MAX_L: all of the common rates (11025,
+ * 16000, 22050, 32000, 44100, 48000, 96000 Hz and so on) are accepted, and
+ * audio_decode_header() rejects the others.
+ */
+
+#define DECIMATOR_TRANSITION 1200
+#define DECIMATOR_MAX_RATE 192000
+#define DECIMATOR_MAX_L 320
+
+/*
+ * Maximum number of input samples given to audio_decimator_run() at once.
+ */
+#define DECIMATOR_CHUNK 4096
+
+typedef struct audio_decimator {
+    uint32_t L, M;         // Upsampling and downsampling factors, in lowest terms.
+    uint32_t taps;         // Number of taps in each phase, a multiple of 4.
+    double *coeffs;        // The L phases, each with its taps in the order of the samples.
+    uint64_t center;       // Delay of the filter, in upsampled samples.
+    double *history;       // Input samples not yet finished with.
+    size_t capacity;       // Size of the history.
+    size_t count;          // Number of samples in the history.
+    int64_t base;          // Index of the first sample in the history.
+    uint64_t inputs;       // Number of input samples given.
+    uint64_t outputs;      // Number of output samples produced.
+} AUDIO_DECIMATOR;
+
+/*
+ * Whether audio at a given sample rate can be converted to AUDIO_FRAME_RATE.
+ *
+ *   @param rate  The sample rate, in samples per second.
+ *   @return  Nonzero if the rate is higher than AUDIO_FRAME_RATE, no higher than
+ *   DECIMATOR_MAX_RATE, and gives a factor L no larger than DECIMATOR_MAX_L.
+ */
+int audio_decimator_supported(uint32_t rate);
+
+/*
+ * Create a decimator.
+ *
+ *   @param rate  Sample rate of the input, for which audio_decimator_supported()
+ *   must be true.
+ *   @return  The decimator, or NULL if it could not be created.
+ */
+AUDIO_DECIMATOR *audio_decimator_create(uint32_t rate);
+
+/*
+ * Prepare a decimator for a new stream of input.
+ */
+void audio_decimator_reset(AUDIO_DECIMATOR *dp);
+
+/*
+ * Convert input samples.  Output samples are produced as soon as all the input
+ * they depend on is available.
+ *
+ *   @param dp  The decimator.
+ *   @param in  Array of n input samples.
+ *   @param n  Number of input samples, at most DECIMATOR_CHUNK.
+ *   @param out  Array to receive the output samples, which must have room for
+ *   n * L / M + 1 of them.
+ *   @return  The number of output samples produced.
+ */
+size_t audio_decimator_run(AUDIO_DECIMATOR *dp, int16_t *in, size_t n, int16_t *out);
+
+/*
+ * Produce the output samples that remain at the end of the input, taking the
+ * input to be silent beyond its end.  There are then ceil(inputs * L / M) output
+ * samples in all.
+ *
+ *   @param dp  The decimator.
+ *   @param out  Array to receive the output samples, which must have room for
+ *   taps + 1 of them (never more than DECIMATOR_CHUNK).
+ *   @return  The number of output samples produced.
+ */
+size_t audio_decimator_finish(AUDIO_DECIMATOR *dp, int16_t *out);
+
+void audio_decimator_destroy(AUDIO_DECIMATOR *dp);
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef DTMF_BATCH_H
+#define DTMF_BATCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "dtmf_channels.h"
+
+/**
+ * DTMF detection on a batch of audio files.
+ * The names of the audio files are read, one per line, from the specified list file.
+ * The files are distributed among the specified number of worker threads, each of
+ * which has its own DTMF detectors that it reuses for all the files it analyzes.
+ * Each event detected is written to the output stream in the same format as by
+ * dtmf_detect(), prefixed by the name of the file and a tab (and, in a file with
+ * several channels, by the channel, as described in dtmf_channels.h).  The events for each
+ * file are written together, and the files appear in the output in the same order as
+ * in the list, regardless of the order in which the threads finish analyzing them.
+ *
+ * A file that cannot be opened or does not have a valid audio header does not stop
+ * the processing of the other files; a message is printed on the standard error
+ * output and the return value reports the failure.
+ *
+ *   @param list_file  Name of the file listing the audio files to be analyzed.
+ *   @param events_out  Output stream to which DTMF events are to be written.
+ *   @param jobs  Number of worker threads to use.
+ *   @param block_size  Number of samples in each block of audio to be analyzed.
+ *   @param options  Other options of the detectors (see dtmf_channels_configure()).
+ *   @return 0 if every file was analyzed and all events were written successfully,
+ *   EOF otherwise.
+ */
+int dtmf_detect_batch(char *list_file, FILE *events_out, int jobs, uint32_t block_size,
+		      DTMF_DETECT_OPTIONS *options);
+
+#endif
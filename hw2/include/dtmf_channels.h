@@ -0,0 +1,121 @@
+#ifndef DTMF_CHANNELS_H
+#define DTMF_CHANNELS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "audio_bulk.h"
+#include "audio_map.h"
+#include "audio_pipe.h"
+#include "dtmf_detector.h"
+
+/*
+ * DTMF detection on audio with several channels, such as a stereo recording of a
+ * call with one party on each channel.  Each channel has a detector of its own, so
+ * its tones are found exactly as they would be in a mono file holding that channel
+ * alone, but the interleaved frames are read (or mapped) only once: they are taken a
+ * chunk at a time and the samples of each channel are passed to its detector.
+ *
+ * Each event is written in the format of dtmf_detect(), prefixed by the number of
+ * its channel, counting from 0, and a tab (after the tag, if there is one).  Events
+ * are written as they are completed, so the events of the different channels are
+ * interleaved roughly in order of time.  With a single channel nothing is added, and
+ * the output is the same as that of a single detector.
+ *
+ * Any number of channels from AUDIO_CHANNELS up to AUDIO_MAX_CHANNELS is accepted,
+ * which covers stereo recordings and the multi-channel files of call recorders.
+ */
+typedef struct dtmf_channels {
+    uint32_t nchannels;          // Number of channels.
+    uint32_t encoding;           // Encoding of the samples.
+    uint32_t rate;               // Sample rate of the audio.
+    DTMF_DETECTOR **detectors;   // One detector for each channel.
+    char **tags;                 // The tag written before the events of each channel.
+    int16_t *frames;             // Frames read or decoded, before they are split up.
+    int16_t *split;              // Samples of one channel.
+} DTMF_CHANNELS;
+
+/*
+ * Options of the detectors, other than the block size, which are the same for every
+ * channel and every file.  A structure of zeros gives the defaults.
+ */
+typedef struct dtmf_detect_options {
+    uint32_t hop;                // The hop, or 0 to leave it as the block size.
+    uint32_t refine;             // Size of the blocks used to refine boundaries, or 0 for none.
+    int fixed;                   // Nonzero to use the fixed-point filters.
+    TONE_SPEC *tones;            // Other tones to be detected, or NULL for none.
+} DTMF_DETECT_OPTIONS;
+
+/*
+ * Create the detectors for audio with a given number of channels.
+ *
+ *   @param block_size  Number of samples in each block to be analyzed.
+ *   @param rate  Sample rate of the audio.
+ *   @param nchannels  Number of channels, in the range [1, AUDIO_MAX_CHANNELS].
+ *   @param events_out  Stream to which detected events are to be written.
+ *   @return  The detectors, or NULL if they could not be created.
+ */
+DTMF_CHANNELS *dtmf_channels_create(uint32_t block_size, uint32_t rate, uint32_t nchannels,
+				    FILE *events_out);
+
+/*
+ * Set the options of every channel's detector, as dtmf_detector_set_hop(),
+ * dtmf_detector_set_refine(), dtmf_detector_set_fixed(), dtmf_detector_set_tones()
+ * and dtmf_detector_set_encoding() do.
+ *
+ *   @param cp  The detectors.
+ *   @param options  The options.
+ *   @param encoding  The encoding field of the audio header.
+ *   @return 0 if successful, EOF if any of the options could not be set.
+ */
+int dtmf_channels_configure(DTMF_CHANNELS *cp, DTMF_DETECT_OPTIONS *options, uint32_t encoding);
+
+/*
+ * Record the analysis of each block of every channel in a trace, as
+ * dtmf_detector_set_trace() does, each with the number of its channel.
+ *
+ *   @param cp  The detectors.
+ *   @param tp  The trace, or NULL to stop tracing.
+ */
+void dtmf_channels_set_trace(DTMF_CHANNELS *cp, DTMF_TRACE *tp);
+
+/*
+ * Prepare the detectors to analyze a new file with the same number of channels,
+ * block size and sample rate, as dtmf_detector_reset() does.
+ *
+ *   @param cp  The detectors.
+ *   @param events_out  Stream to which detected events are to be written.
+ *   @param tag  If not NULL, a string written, followed by a tab, before each event
+ *   and its channel number.
+ *   @return 0 if successful, EOF if storage for the tags could not be allocated.
+ */
+int dtmf_channels_reset(DTMF_CHANNELS *cp, FILE *events_out, char *tag);
+
+/*
+ * Read frames from an input stream, positioned at the start of the audio sample
+ * data, until EOF and analyze each channel, then finish every detector.  An
+ * incomplete final frame is ignored.
+ *
+ *   @param cp  The detectors.
+ *   @param audio_in  Stream from which frames are to be read.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_channels_run(DTMF_CHANNELS *cp, FILE *audio_in);
+
+/*
+ * The same as dtmf_channels_run(), for a mapped audio file whose header has been read.
+ */
+int dtmf_channels_run_mapped(DTMF_CHANNELS *cp, AUDIO_MAP *mp);
+
+/*
+ * The same as dtmf_channels_run(), for a stream being read by a pipe (see
+ * audio_pipe.h), whose buffers are analyzed as the reader thread fills them.
+ */
+int dtmf_channels_run_pipe(DTMF_CHANNELS *cp, AUDIO_PIPE *pp);
+
+/*
+ * Free the detectors and all storage associated with them.
+ */
+void dtmf_channels_destroy(DTMF_CHANNELS *cp);
+
+#endif
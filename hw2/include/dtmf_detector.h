@@ -0,0 +1,401 @@
+#ifndef DTMF_DETECTOR_H
+#define DTMF_DETECTOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "audio_map.h"
+#include "audio_resample.h"
+#include "dtmf.h"
+#include "dtmf_plan.h"
+#include "dtmf_trace.h"
+#include "goertzel_bank.h"
+#include "tone_bank.h"
+
+/*
+ * Minimum length, in samples, of a DTMF event that is reported.
+ * This corresponds (approximately) to MIN_DTMF_DURATION at AUDIO_FRAME_RATE.
+ */
+#define DTMF_MIN_EVENT_SAMPLES 250
+
+/*
+ * Factor by which the energy of a block must fall short of the least energy that
+ * could produce a symbol for dtmf_block_silent() to report it as silent.
+ */
+#define DTMF_GATE_MARGIN 2
+
+/*
+ * When windows overlap, the outputs of the sliding filters are recomputed from
+ * the samples in the window after this many blocks' worth of samples, so that
+ * rounding errors cannot accumulate without bound.
+ */
+#define DTMF_SLIDE_RESYNC 64
+
+/*
+ * Smallest block used to refine the boundaries of events.  Shorter blocks cannot
+ * resolve the DTMF frequencies well enough for dtmf_block_symbol() to find a symbol
+ * in them, so the boundaries would never move.
+ */
+#define DTMF_MIN_FINE_SIZE 100
+
+/*
+ * Callbacks through which a DTMF detector reports tones as soon as they are
+ * confirmed, for applications that cannot wait for an event to be complete.
+ * tone_start is called once a tone has been present in confirm_blocks consecutive
+ * blocks, or windows if they overlap (so the latency from the onset of the tone is at most confirm_blocks + 1
+ * blocks), giving the index of the first sample of the tone.  tone_end is called when
+ * a tone for which tone_start was called is no longer present, giving the indices of
+ * its first sample and of the sample following its last sample.  Unlike the events
+ * written to the output stream, tones reported through the callbacks are not subject
+ * to the minimum duration.  Either callback may be NULL.
+ */
+typedef struct dtmf_listener {
+    void (*tone_start)(void *arg, char symbol, uint32_t start);
+    void (*tone_end)(void *arg, char symbol, uint32_t start, uint32_t end);
+    void *arg;                          // Passed to the callbacks.
+    uint32_t confirm_blocks;            // Blocks a tone must last before tone_start is called.
+} DTMF_LISTENER;
+
+/*
+ * A DTMF detector holds all the state needed to perform DTMF detection on a
+ * single stream of audio samples: the filter bank and its plan, the samples of the
+ * block currently being collected, the strengths computed for the most recent block,
+ * and the DTMF event (if any) currently in progress.  No global variables are used,
+ * so any number of detectors may be in use at the same time, in the same or in
+ * different threads (as long as each detector is used by only one thread at a time).
+ *
+ * Samples are given to the detector in buffers of any size by dtmf_detector_feed().
+ * Each time a complete block of samples has been collected, it is analyzed exactly
+ * as described for dtmf_detect(), completed events are written to the output
+ * stream in the same tab-separated format, and tones are reported to the listener,
+ * if one has been set.  When there are no more samples,
+ * dtmf_detector_finish() ends any event still in progress.
+ *
+ * Unless the gate is turned off, a block whose energy is too low for it to contain
+ * any symbol (see dtmf_block_silent()) is not run through the filter bank at all.
+ * Since such a block could never have been found to contain a symbol, the events
+ * detected are the same either way.
+ *
+ * Normally the blocks do not overlap, so the boundaries of events are multiples of
+ * the block size.  If a hop smaller than the block size is set, a window of
+ * block_size samples is analyzed every hop samples instead, using a sliding filter
+ * bank whose cost per sample is the same whatever the hop.  The symbol found in each
+ * window is taken to apply to the hop samples at its center, and events are formed
+ * from these segments just as they are from blocks.  (A window is found to contain a
+ * tone when roughly half of it or more does, so using the edges of the windows would
+ * make every event too long.)  With the block size as the hop, the segments are the
+ * blocks themselves.
+ *
+ * Non-overlapping blocks may instead be analyzed by the fixed-point filters of
+ * goertzel_fixed.h, which work on the samples without converting them to double.
+ *
+ * The boundaries of events found with non-overlapping blocks may be refined using
+ * smaller blocks.  The detector then keeps the samples of the last two blocks, and
+ * when an event starts or ends at the boundary between them, it analyzes just those
+ * samples again with blocks of the fine size, laid out so that one of them starts at
+ * the boundary.  An event is taken to start at the first fine block in which its
+ * symbol is found, and to end after the last, or at the coarse boundary if the symbol
+ * is found in no fine block.  The large blocks do most of the work, and small blocks
+ * are only used for a pair of blocks at each boundary, but the boundaries are as
+ * precise as those found with small blocks.
+ *
+ * Audio at a higher sample rate than AUDIO_FRAME_RATE, if audio_decimator_supported()
+ * allows it, is first converted to AUDIO_FRAME_RATE by a decimator (audio_resample.h),
+ * so that it is analyzed by the same filters, in blocks of the same duration, at the
+ * same cost per second.  The block size and DTMF_MIN_EVENT_SAMPLES then count samples
+ * after conversion, but the indices of events are those of the samples given to the
+ * detector.
+ *
+ * A tone bank (tone_bank.h) may be attached to a detector, so that other tones are
+ * detected in the same pass over the samples.  Its events are written to the same
+ * output stream, as they are completed, with the name of the tone in place of the
+ * DTMF symbol.
+ */
+typedef struct dtmf_detector {
+    DTMF_PLAN *plan;                    // Filter coefficients (shared, from the plan cache).
+    GOERTZEL_BANK bank;                 // Filter state.
+    uint32_t block_size;                // Number of samples in each block.
+    double *block;                      // Scaled samples of the block being collected.
+    double *skipped;                    // Samples of the last block, if it was skipped.
+    int16_t *raw;                       // Like block and skipped, but for the
+    int16_t *raw_skipped;               // fixed-point filters, which use the samples as read.
+    uint32_t fill;                      // Number of samples collected so far in the block.
+    uint32_t samples;                   // Total number of samples given to the detector.
+    uint32_t rate;                      // Sample rate of the samples given to the detector.
+    AUDIO_DECIMATOR *decimator;         // If not NULL, converts them to AUDIO_FRAME_RATE,
+    uint32_t samples_in;                // in which case samples counts those converted.
+    uint32_t hop;                       // Number of samples from one window to the next.
+    GOERTZEL_SLIDE slide;               // Filter state, if windows overlap.
+    uint32_t next_window;               // Value of samples at the end of the next window.
+    uint32_t slid;                      // Samples since the sliding filters were recomputed.
+    uint32_t event_start;               // Starting index of the current event.
+    char event_symbol;                  // Symbol of the current event, or 0 if none.
+    uint32_t event_blocks;              // Number of blocks in the current event so far.
+    int event_announced;                // Nonzero if tone_start was called for the current event.
+    double strengths[NUM_DTMF_FREQS];   // Strengths computed for the most recent block.
+    int strengths_stale;                // Nonzero if the most recent block was skipped.
+    int gate;                           // Nonzero if silent blocks are to be skipped.
+    int fixed;                          // Nonzero if fixed-point filters are used.
+    uint32_t encoding;                  // Encoding of samples read or mapped from a file.
+    uint32_t blocks;                    // Number of blocks analyzed so far.
+    uint32_t blocks_skipped;            // Number of those found to be silent.
+    FILE *out;                          // If not NULL, stream to which events are written.
+    char *tag;                          // If not NULL, written before each event.
+    DTMF_LISTENER listener;             // Callbacks for tones, if any.
+    TONE_BANK *tones;                   // If not NULL, detects other tones in the same samples.
+    uint32_t refine;                    // Size of the blocks used to refine boundaries, or 0.
+    DTMF_PLAN *fine_plan;               // Filter coefficients for those blocks,
+    GOERTZEL_BANK fine_bank;            // and the filter state.
+    double *history;                    // If refining, scaled samples of the last two blocks.
+    DTMF_TRACE *trace;                  // If not NULL, receives the analysis of each block,
+    uint32_t channel;                   // recorded as being of this channel.
+} DTMF_DETECTOR;
+
+/*
+ * Create a DTMF detector.
+ *
+ *   @param block_size  Number of samples in each block to be analyzed.
+ *   @param rate  Sample rate of the audio, in samples per second.
+ *   @param events_out  Stream to which detected DTMF events are to be written,
+ *   or NULL if they are only to be reported through a listener.
+ *   @return  The new detector, or NULL if it could not be created.
+ */
+DTMF_DETECTOR *dtmf_detector_create(uint32_t block_size, uint32_t rate, FILE *events_out);
+
+/*
+ * Select whether a DTMF detector uses the fixed-point filters to analyze blocks.
+ * This must be done before any samples are given to the detector, and has no
+ * effect if its windows overlap.
+ *
+ *   @param dp  The detector.
+ *   @param fixed  Nonzero to use the fixed-point filters, 0 to use floating point.
+ *   @return 0 if successful, EOF if storage could not be allocated.
+ */
+int dtmf_detector_set_fixed(DTMF_DETECTOR *dp, int fixed);
+
+/*
+ * Set the encoding of the samples that a DTMF detector reads from a stream or takes
+ * from a mapped file: PCM16_ENCODING (the default), MULAW_ENCODING or ALAW_ENCODING.
+ * Samples in the 8-bit encodings are decoded as they are collected into blocks.
+ *
+ *   @param dp  The detector.
+ *   @param encoding  The encoding field of the audio header.
+ *   @return 0 if successful, EOF if the encoding is not supported.
+ */
+int dtmf_detector_set_encoding(DTMF_DETECTOR *dp, uint32_t encoding);
+
+/*
+ * Select whether a DTMF detector refines the boundaries of the events it finds, and
+ * with what size of block.  This must be done before any samples are given to the
+ * detector, and it remains in effect when the detector is reset.  It has no effect
+ * if its windows overlap.
+ *
+ *   @param dp  The detector.
+ *   @param fine_size  Number of samples in each of the blocks used to refine
+ *   boundaries, at least DTMF_MIN_FINE_SIZE and less than the block size, or 0 not
+ *   to refine them.
+ *   @return 0 if successful, EOF if the size is out of range or storage could not
+ *   be allocated.
+ */
+int dtmf_detector_set_refine(DTMF_DETECTOR *dp, uint32_t fine_size);
+
+/*
+ * Record the analysis of each block (or window) analyzed by a DTMF detector in a
+ * trace (see dtmf_trace.h).  Several detectors may share a trace, if they are used
+ * by a single thread.
+ *
+ *   @param dp  The detector.
+ *   @param tp  The trace, or NULL to stop tracing.
+ *   @param channel  Channel number to be recorded with each block.
+ */
+void dtmf_detector_set_trace(DTMF_DETECTOR *dp, DTMF_TRACE *tp, uint32_t channel);
+
+/*
+ * Attach a tone bank to a DTMF detector, to detect the tones of a description in the
+ * same samples, or remove it.  This must be done before any samples are given to the
+ * detector, and it remains in effect when the detector is reset.
+ *
+ *   @param dp  The detector.
+ *   @param sp  The tones to be detected, which must remain valid while the detector
+ *   is used, or NULL for none.
+ *   @return 0 if successful, EOF if storage could not be allocated.
+ */
+int dtmf_detector_set_tones(DTMF_DETECTOR *dp, TONE_SPEC *sp);
+
+/*
+ * Set the callbacks through which a DTMF detector reports tones.  This should be
+ * done before any samples are given to the detector.
+ *
+ *   @param dp  The detector.
+ *   @param lp  The callbacks to be used, which are copied, or NULL for none.
+ */
+void dtmf_detector_set_listener(DTMF_DETECTOR *dp, DTMF_LISTENER *lp);
+
+/*
+ * Set the number of samples from the start of one window analyzed by a DTMF
+ * detector to the start of the next.  This must be done before any samples are
+ * given to the detector, and it remains in effect when the detector is reset.
+ *
+ *   @param dp  The detector.
+ *   @param hop  The hop, in the range [1, block_size].  The block size, which is
+ *   the default, means that windows do not overlap.
+ *   @return 0 if successful, EOF if the hop is out of range.
+ */
+int dtmf_detector_set_hop(DTMF_DETECTOR *dp, uint32_t hop);
+
+/*
+ * Give samples to a DTMF detector.  Events that are completed by these samples
+ * are written to the detector's output stream before this function returns.
+ *
+ *   @param dp  The detector.
+ *   @param samples  Array of samples, in host byte order.
+ *   @param n  Number of samples in the array.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_feed(DTMF_DETECTOR *dp, int16_t *samples, size_t n);
+
+/*
+ * The same as dtmf_detector_feed(), but for samples in the encoding and byte order
+ * of the file, as in a mapped audio file (see audio_map.h).  The samples are decoded
+ * as they are collected into blocks, and need not be aligned.
+ *
+ *   @param dp  The detector.
+ *   @param data  The bytes of the samples (2 * n of them for PCM16_ENCODING, n for
+ *   the 8-bit encodings).
+ *   @param n  Number of samples.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_feed_mapped(DTMF_DETECTOR *dp, uint8_t *data, size_t n);
+
+/*
+ * Signal the end of the audio to a DTMF detector.  Any DTMF event still in
+ * progress ends at the index of the last sample given to the detector, and it is
+ * written to the output stream if it is long enough.  Any incomplete final block is
+ * not analyzed.  After this function has been called, the detector may only be reset
+ * or destroyed.
+ *
+ *   @param dp  The detector.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_finish(DTMF_DETECTOR *dp);
+
+/*
+ * Give a DTMF detector the result of analyzing blocks elsewhere, as when the blocks
+ * of a recording are analyzed in parallel.  The detector proceeds exactly as if it had
+ * been given nblocks complete blocks of samples, in each of which it found the
+ * specified symbol.
+ *
+ *   @param dp  The detector, which must not hold a partially collected block,
+ *   and whose windows must not overlap.
+ *   @param symbol  The symbol found in each of the blocks, or 0 if none.
+ *   @param nblocks  Number of blocks.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_replay(DTMF_DETECTOR *dp, char symbol, uint32_t nblocks);
+
+/*
+ * Prepare a DTMF detector to analyze a new stream of samples, with the same
+ * block size and sample rate, reusing its storage.
+ *
+ *   @param dp  The detector.
+ *   @param events_out  Stream to which detected DTMF events are to be written.
+ *   @param tag  If not NULL, a string written, followed by a tab, before each event.
+ */
+void dtmf_detector_reset(DTMF_DETECTOR *dp, FILE *events_out, char *tag);
+
+/*
+ * Read samples from an input stream, positioned at the start of the audio sample
+ * data, until EOF and give them to a DTMF detector, then call dtmf_detector_finish().
+ *
+ *   @param dp  The detector.
+ *   @param audio_in  Stream from which samples are to be read.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_run(DTMF_DETECTOR *dp, FILE *audio_in);
+
+/*
+ * Give all the samples of a mapped audio file, whose header has been read, to a
+ * DTMF detector, then call dtmf_detector_finish().
+ *
+ *   @param dp  The detector.
+ *   @param mp  The mapped audio file.
+ *   @return 0 if successful, EOF if an error occurred writing an event.
+ */
+int dtmf_detector_run_mapped(DTMF_DETECTOR *dp, AUDIO_MAP *mp);
+
+/*
+ * Analyze a complete block of samples exactly as a detector analyzes each block it
+ * collects, with the same gate and filters, but without forming events from it:
+ * the block is not counted in the samples given to the detector, and has no effect
+ * on the event in progress.  This allows the blocks of a file to be analyzed by
+ * several detectors, and their symbols given to one with dtmf_detector_replay().
+ * Only non-overlapping blocks at the detector's own rate may be analyzed this way.
+ *
+ *   @param dp  The detector.
+ *   @param samples  The block_size samples of the block, in host byte order.
+ *   @return  The symbol found in the block, or 0 if none.
+ */
+char dtmf_detector_analyze(DTMF_DETECTOR *dp, int16_t *samples);
+
+/*
+ * Obtain the strengths of the NUM_DTMF_FREQS frequencies in the most recent
+ * complete block given to a DTMF detector.  If that block was skipped because it
+ * was silent, the strengths are computed now.
+ *
+ *   @param dp  The detector.
+ *   @return  Array of NUM_DTMF_FREQS strengths, which remains valid until more
+ *   samples are given to the detector.
+ */
+double *dtmf_detector_strengths(DTMF_DETECTOR *dp);
+
+/*
+ * Free a DTMF detector and all storage associated with it.
+ */
+void dtmf_detector_destroy(DTMF_DETECTOR *dp);
+
+/*
+ * Determine which DTMF symbol, if any, is present in a block, given the strengths
+ * of the NUM_DTMF_FREQS frequencies in that block.  A symbol is present if the
+ * strongest row and column frequencies together exceed MINUS_20DB, are within
+ * FOUR_DB of each other, and each exceed every other row (respectively column)
+ * frequency by at least SIX_DB.
+ *
+ *   @param strengths  Strengths of the DTMF frequencies.
+ *   @return  The symbol present in the block, or 0 if none.
+ */
+char dtmf_block_symbol(double *strengths);
+
+/*
+ * The same as dtmf_block_symbol(), but also reporting the strongest row and column
+ * frequencies and the outcome of the tests.
+ *
+ *   @param strengths  Strengths of the DTMF frequencies.
+ *   @param rowp  Set to the index of the strongest row frequency.
+ *   @param colp  Set to the index of the strongest column frequency.
+ *   @param reasonp  Set to DTMF_BLOCK_ACCEPTED if a symbol is present, otherwise to
+ *   the DTMF_BLOCK_ outcome (see dtmf_trace.h) of the first test that failed.
+ *   @return  The symbol present in the block, or 0 if none.
+ */
+char dtmf_block_classify(double *strengths, int *rowp, int *colp, int *reasonp);
+
+/*
+ * Determine whether a block is too quiet to contain any DTMF symbol, without running
+ * the filter bank over it.  For a block of N samples with energy E, no strength can
+ * exceed 2 * E / N (the magnitude of the filter output is at most the sum of the
+ * magnitudes of the samples, whose square is at most N * E), so the strongest row and
+ * column frequencies together cannot reach MINUS_20DB unless 4 * E / N does.  A block
+ * is only considered silent if it falls short of that by DTMF_GATE_MARGIN, which
+ * leaves ample room for rounding in the filters.
+ *
+ *   @param x  Samples of the block, scaled as for goertzel_bank_step().
+ *   @param n  Number of samples in the block.
+ *   @return  Nonzero if the block certainly contains no symbol, otherwise 0.
+ */
+int dtmf_block_silent(double *x, uint32_t n);
+
+/*
+ * The same as dtmf_block_silent(), for samples that have not been scaled.
+ */
+int dtmf_raw_block_silent(int16_t *x, uint32_t n);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef DTMF_EVENTS_H
+#define DTMF_EVENTS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "audio_noise.h"
+
+/*
+ * Reader for the script of DTMF events given to the generator.
+ *
+ * Each line of the script has the form "START\tEND\tSYMBOL\n", START and END being
+ * sample indices in decimal.  Rather than being read a character at a time as the
+ * samples are generated, the script is read in large pieces and parsed a chunk of
+ * DTMF_EVENT_CHUNK events at a time into an array, the events being validated as
+ * they are parsed: they must be in order of start index, must not overlap and must
+ * lie within the length of the audio.  Once an event that ends at the end of the
+ * audio has been parsed, the rest of the script is ignored.
+ */
+
+/*
+ * Number of events parsed at a time.
+ */
+#define DTMF_EVENT_CHUNK 1024
+
+/*
+ * Number of characters of the script read at a time.
+ */
+#define DTMF_EVENT_TEXT 8192
+
+/*
+ * A DTMF event: a tone given by a row and a column of dtmf_symbol_names, sounding
+ * from sample start up to, but not including, sample end.
+ */
+typedef struct dtmf_event {
+    uint32_t start;
+    uint32_t end;
+    uint8_t row;
+    uint8_t col;
+} DTMF_EVENT;
+
+typedef struct dtmf_event_reader {
+    FILE *in;                             // Stream from which the script is read.
+    uint32_t length;                      // Number of samples in the audio.
+    uint32_t last_end;                    // End of the last event parsed.
+    int done;                             // Nonzero once no more events remain.
+    size_t count;                         // Number of events in the array.
+    DTMF_EVENT events[DTMF_EVENT_CHUNK];
+    size_t pos;                           // Position of the next character in text.
+    size_t fill;                          // Number of characters in text.
+    char text[DTMF_EVENT_TEXT];
+} DTMF_EVENT_READER;
+
+/*
+ * Set up a reader of a script of events.
+ *
+ *   @param rp  The reader.
+ *   @param in  Stream from which the script is to be read.
+ *   @param length  Number of samples in the audio.
+ */
+void dtmf_events_init(DTMF_EVENT_READER *rp, FILE *in, uint32_t length);
+
+/*
+ * Parse the next chunk of events into the array of a reader, replacing the events
+ * that were there.
+ *
+ *   @param rp  The reader.
+ *   @return  The number of events parsed, which is 0 once the script is exhausted,
+ *   or EOF if the script is malformed or an event is out of order, overlaps the
+ *   one before it or lies beyond the end of the audio.
+ */
+int dtmf_events_read(DTMF_EVENT_READER *rp);
+
+/*
+ * Parse all of the events of a script, as dtmf_events_read() would a chunk at a time.
+ *
+ *   @param in  Stream from which the script is to be read.
+ *   @param length  Number of samples in the audio.
+ *   @param countp  Set to the number of events.
+ *   @return  An array of the events, to be freed by the caller, or NULL if the script
+ *   is invalid or memory is exhausted.
+ */
+DTMF_EVENT *dtmf_events_read_all(FILE *in, uint32_t length, size_t *countp);
+
+/*
+ * Generate the samples in a range of sample indices, given the events that sound in
+ * it, and pass them to a mixer.  Each sample is the tone of the event whose range
+ * contains its index, or silence if there is none, so the samples in a range do not
+ * depend on how the audio is divided into ranges.
+ *
+ *   @param mp  The mixer, whose next sample is the first sample in the range.
+ *   @param events  Array of events, in order.  Events that end before the range or
+ *   start after it are ignored.
+ *   @param n  Number of events.
+ *   @param lo  Index of the first sample in the range.
+ *   @param hi  Index just beyond the last sample in the range.
+ *   @return 0 if successful, EOF if an error occurred in writing.
+ */
+int dtmf_events_render(AUDIO_MIXER *mp, DTMF_EVENT *events, size_t n, uint32_t lo, uint32_t hi);
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef DTMF_OPTIONS_H
+#define DTMF_OPTIONS_H
+
+#include <stdio.h>
+
+/*
+ * Options of the program beyond those declared in const.h, which is left as it
+ * was given: the values set by validargs() for the additional options, and a usage
+ * message that describes all of the options, which replaces USAGE().
+ */
+
+#define DTMF_USAGE(program_name, retcode) do { \
+fprintf(stderr, "USAGE: %s %s\n", program_name, \
+"[-h] -g|-d [-t MSEC] [-n NOISE_FILE] [-l LEVEL] [-b BLOCKSIZE] [-s HOP] [-r FINE] [--fixed] [--batch LISTFILE] [--tones TONEFILE] [--queue DEPTH] [--trace FILE] [-j JOBS]\n" \
+"   -h       Help: displays this help menu.\n" \
+"   -g       Generate: read DTMF events from standard input, output audio data to standard output.\n" \
+"   -d       Detect: read audio data from standard input, output DTMF events to standard output.\n\n" \
+"            Optional additional parameters for -g (not permitted with -d):\n" \
+"               -t MSEC         Time duration (in milliseconds, default 1000) of the audio output.\n" \
+"               -n NOISE_FILE   specifies the name of an audio file containing \"noise\" to be combined\n" \
+"                               with the synthesized DTMF tones.\n" \
+"               -l LEVEL        specifies the loudness ratio (in dB, positive or negative) of the\n" \
+"                               noise to that of the DTMF tones.  A LEVEL of 0 (the default) means the\n" \
+"                               same level, negative values mean that the DTMF tones are louder than\n" \
+"                               the noise, positive values mean that the noise is louder than the\n" \
+"                               DTMF tones.\n" \
+"               -j JOBS         number of threads (range [1, 64], default 1) used for generation\n" \
+"                                when standard output is a file.\n\n" \
+"            Optional additional parameters for -d (not permitted with -g):\n" \
+"               -b BLOCKSIZE    specifies the number of samples (range [10, 1000], default 100)\n" \
+"                                in each block of audio to be analyzed for the presence of DTMF tones.\n" \
+"                                Audio at a higher sample rate (such as 16000 or 44100) is first\n" \
+"                                converted to 8000, and BLOCKSIZE and HOP count converted samples.\n" \
+"                                Each channel of audio with several channels is analyzed separately,\n" \
+"                                and its events are prefixed by the channel number (from 0).\n" \
+"               -s HOP          analyze a block every HOP samples (range [1, BLOCKSIZE], default\n" \
+"                                BLOCKSIZE), so that blocks overlap and events are located more\n" \
+"                                precisely.  The cost does not depend on HOP.  -j has no effect\n" \
+"                                on a single file if HOP is less than BLOCKSIZE.\n" \
+"               -r FINE         refine the start and end of each event by analyzing the two blocks\n" \
+"                                around it again in blocks of FINE samples (range [100, BLOCKSIZE - 1]),\n" \
+"                                so that a large BLOCKSIZE locates events as precisely as FINE would.\n" \
+"                                Ignored if HOP is less than BLOCKSIZE.  -j has no effect on a single\n" \
+"                                file with -r.\n" \
+"               --fixed         analyze blocks using fixed-point arithmetic on the 16-bit samples\n" \
+"                                (ignored if HOP is less than BLOCKSIZE).\n" \
+"               --batch LISTFILE  analyze each of the audio files named (one per line) in LISTFILE,\n" \
+"                                instead of standard input.  Each event is output prefixed by the name\n" \
+"                                of the file in which it was detected.\n" \
+"               --tones TONEFILE  also detect the tones (call progress, fax, MF and so on) described\n" \
+"                                in TONEFILE, in the same pass; each event is output with the name\n" \
+"                                of the tone in place of the DTMF symbol.  -j has no effect on a\n" \
+"                                single file with --tones.\n" \
+"               --queue DEPTH   read the audio on a separate thread, up to DEPTH (range [2, 64])\n" \
+"                                large buffers ahead of the detector, so that reading and detection\n" \
+"                                overlap, which helps with slow storage and pipes.  The number of\n" \
+"                                times the reader and the detector waited for each other is written\n" \
+"                                to standard error.  Ignored with --batch; -j has no effect on a\n" \
+"                                single file read this way.\n" \
+"               --trace FILE    write the energy, the eight strengths, the strongest row and column\n" \
+"                                and the outcome of the tests for each block to FILE, as CSV if its\n" \
+"                                name ends in .csv and in a compact binary form otherwise.\n" \
+"                                Ignored with --batch; -j has no effect on a single file traced.\n" \
+"               -j JOBS         number of threads (range [1, 64], default 1) used for detection.\n" \
+"                                In --batch mode, this many files are analyzed concurrently;\n" \
+"                                otherwise, if standard input is a file, it is divided among the threads.\n" \
+); \
+exit(retcode); \
+} while(0)
+
+extern int hop_size;                // Number of samples from one block to the next in DTMF tone detection.
+extern int refine_size;             // Block size used to refine DTMF event boundaries, or 0 if not refined.
+extern int fixed_point;             // Nonzero if DTMF tone detection uses fixed-point arithmetic.
+extern char *batch_file;            // Name of file listing audio files to analyze, or NULL if none.
+extern int num_jobs;                // Number of threads used for generation or detection.
+extern char *tones_file;            // Name of file describing other tones to detect, or NULL if none.
+extern struct tone_spec *tone_spec; // The tones described in tones_file, once it has been read.
+extern int queue_depth;             // Number of buffers read ahead by a reader thread in detection, or 0.
+extern char *trace_file;            // Name of file to which the analysis of each block is written, or NULL.
+
+/*
+ * Largest number of threads that may be requested with -j.
+ */
+#define MAX_JOBS 64
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef DTMF_PARALLEL_H
+#define DTMF_PARALLEL_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+/**
+ * DTMF detection on a single recording using several threads.
+ * The audio header is read and validated as by dtmf_detect().  If the input stream
+ * is a regular file, its sample data is divided into ranges consisting of whole
+ * blocks, one range per thread, and each thread reads its range (by offset, so that
+ * the threads do not share a file position) and determines which DTMF symbol, if any,
+ * is present in each block.  The per-block results are then combined, in order, by a
+ * single detector, so events that cross the boundary between two ranges are joined
+ * and the minimum duration is applied exactly as in the sequential case.  The output
+ * is therefore identical to that of dtmf_detect().
+ *
+ * If the input stream is not a regular file (for example, a pipe), the samples cannot
+ * be divided up in advance, and detection is performed sequentially.  So is detection
+ * on audio with several channels (see dtmf_channels.h) or at a sample rate that must
+ * be converted.
+ *
+ *   @param audio_in  Input stream from which to read audio header and sample data.
+ *   @param events_out  Output stream to which DTMF events are to be written.
+ *   @param jobs  Number of threads to use.
+ *   @param block_size  Number of samples in each block of audio to be analyzed.
+ *   @param fixed  Nonzero if the blocks are to be analyzed by the fixed-point filters.
+ *   @return 0 if reading of audio and writing of DTMF events is successful, EOF otherwise.
+ */
+int dtmf_detect_parallel(FILE *audio_in, FILE *events_out, int jobs, uint32_t block_size,
+			 int fixed);
+
+/**
+ * DTMF generation using several threads.
+ * The events are read and validated as by dtmf_generate(), all of them before any
+ * samples are generated.  If the output stream is a regular file, the header is
+ * written, the file is extended to its final size, and the sample indices are divided
+ * into ranges, one per thread.  Each thread generates the samples in its range and
+ * writes them to their places in the file.  Since a sample depends only on its index,
+ * the events and the noise sample with the same index, the output is identical to
+ * that of dtmf_generate().
+ *
+ * If the output stream is not a regular file, or was opened for appending, samples
+ * can only be written in order, and generation is performed sequentially.
+ *
+ *   @param events_in  Stream from which to read DTMF events.
+ *   @param audio_out  Stream to which to write audio header and sample data.
+ *   @param length  Number of audio samples to be written.
+ *   @param jobs  Number of threads to use.
+ *   @return 0 if the header and specified number of samples are written successfully,
+ *   EOF otherwise.
+ */
+int dtmf_generate_parallel(FILE *events_in, FILE *audio_out, uint32_t length, int jobs);
+
+#endif
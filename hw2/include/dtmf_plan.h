@@ -0,0 +1,100 @@
+#ifndef DTMF_PLAN_H
+#define DTMF_PLAN_H
+
+#include <stdint.h>
+
+#include "dtmf.h"
+
+/*
+ * Vector type used to hold one value per filter for a group of
+ * GOERTZEL_BANK_LANES filters.  The coefficients and state variables of the
+ * NUM_DTMF_FREQS filters are kept in GOERTZEL_BANK_VECS such vectors.
+ */
+#define GOERTZEL_BANK_LANES 4
+#define GOERTZEL_BANK_VECS (NUM_DTMF_FREQS / GOERTZEL_BANK_LANES)
+
+typedef double goertzel_vec __attribute__ ((vector_size (GOERTZEL_BANK_LANES * sizeof(double))));
+
+/*
+ * Fixed-point coefficients are held with GOERTZEL_FIXED_BITS fraction bits,
+ * one 32-bit lane per filter (see goertzel_fixed.h).
+ */
+#define GOERTZEL_FIXED_BITS 14
+
+typedef int32_t goertzel_ivec __attribute__ ((vector_size (NUM_DTMF_FREQS * sizeof(int32_t))));
+
+/*
+ * A kernel runs the recurrence of all the filters over the first N - 1 samples of
+ * a block, starting from zero state, and stores the resulting state variables
+ * (see goertzel_kernel.h).
+ */
+typedef void goertzel_bank_kernel(double *x, goertzel_vec *s1, goertzel_vec *s2);
+
+/*
+ * A detector "plan" holds everything about the Goertzel filters used for DTMF
+ * detection that depends only on the block size, the sample rate and the set
+ * of frequencies: the coefficient B used at each iteration, as well as the
+ * values C and D (see goertzel.h) used in the final iteration.  Computing these
+ * once means that analyzing a block costs only multiplications and additions,
+ * with no calls to sin() or cos().
+ *
+ * The values are computed by exactly the same expressions as are used by
+ * goertzel_init() and goertzel_strength(), so the strengths obtained using a plan
+ * are identical to those obtained using separate GOERTZEL_STATE instances.
+ *
+ * If a kernel specialized for the block size, sample rate and coefficients has
+ * been compiled in, the plan also records it, and whole blocks are analyzed with
+ * it instead of with goertzel_bank_step().
+ *
+ * A plan is not modified once it has been created, so a single plan may be
+ * shared by any number of filter banks, including banks used by different threads.
+ */
+typedef struct dtmf_plan {
+    uint32_t N;                            // Number of samples in each block.
+    uint32_t rate;                         // Sample rate, in samples per second.
+    int freqs[NUM_DTMF_FREQS];             // Frequency of each filter, in Hz.
+    double k[NUM_DTMF_FREQS];              // Frequency "index" of each filter.
+    double A[NUM_DTMF_FREQS];              // 2 * pi * k / N for each filter.
+    goertzel_vec B[GOERTZEL_BANK_VECS];    // 2 * cos(A).
+    goertzel_vec re_C[GOERTZEL_BANK_VECS]; // C = exp(-j * A).
+    goertzel_vec im_C[GOERTZEL_BANK_VECS];
+    goertzel_vec re_D[GOERTZEL_BANK_VECS]; // D = exp(-j * 2 * pi * k * (N - 1) / N).
+    goertzel_vec im_D[GOERTZEL_BANK_VECS];
+    double NN;                             // N * N, by which the strengths are scaled.
+    goertzel_ivec B_fixed;                 // B, rounded to GOERTZEL_FIXED_BITS fraction bits.
+    goertzel_bank_kernel *bank_kernel;     // Specialized kernel, or NULL if there is none.
+    struct dtmf_plan *next;                // Link used by the plan cache.
+} DTMF_PLAN;
+
+/*
+ * Create a new plan.
+ *
+ *   @param N  Number of samples in each block.
+ *   @param rate  Sample rate, in samples per second.
+ *   @param freqs  Table of NUM_DTMF_FREQS frequencies, in Hz.
+ *   @return  The new plan, or NULL if storage could not be allocated.
+ */
+DTMF_PLAN *dtmf_plan_create(uint32_t N, uint32_t rate, int *freqs);
+
+/*
+ * Free a plan created by dtmf_plan_create().  Plans obtained from
+ * dtmf_plan_get() belong to the cache and must not be passed to this function.
+ */
+void dtmf_plan_destroy(DTMF_PLAN *pp);
+
+/*
+ * Obtain a plan from the plan cache, creating it if no plan for the same block
+ * size, sample rate and frequencies has been created yet.  This function may be
+ * called concurrently from several threads.
+ *
+ *   @return  The cached plan, or NULL if storage could not be allocated.
+ */
+DTMF_PLAN *dtmf_plan_get(uint32_t N, uint32_t rate, int *freqs);
+
+/*
+ * Free all the plans in the plan cache.  No plan previously returned by
+ * dtmf_plan_get() may be used after this function has been called.
+ */
+void dtmf_plan_cache_clear(void);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef DTMF_SYNTH_H
+#define DTMF_SYNTH_H
+
+#include <stdint.h>
+
+/*
+ * Synthesis of DTMF tones without a call to cos() for every sample.
+ *
+ * The value of a DTMF tone at sample index i is
+ *
+ *   (cos(w_row * i) * 0.5 + cos(w_col * i) * 0.5) * INT16_MAX,
+ *
+ * where w_row and w_col are the angular frequencies (in radians per sample) of the
+ * row and column tones.  Each cosine is produced by a recursive digital oscillator,
+ * using the identity cos(w * (n + L)) = 2 * cos(w * L) * cos(w * n) - cos(w * (n - L)).
+ * DTMF_SYNTH_LANES oscillators run side by side in a vector, lane l producing the
+ * samples with index congruent to l modulo DTMF_SYNTH_LANES, so each step of the
+ * recurrence yields DTMF_SYNTH_LANES samples.
+ *
+ * The rounding errors of the recurrence grow with the number of steps, so the
+ * oscillators are restarted from values computed by cos() at every multiple of
+ * DTMF_SYNTH_SPAN samples.  Far into a one-minute file the samples then
+ * differ from those computed by cos() by less than 1e-5 of one unit of the 16-bit
+ * output (see the synth_accuracy test).  A stored sample only changes where the
+ * exact value lies that close to an integer, which happens a few times in a
+ * million samples, and then by one unit.
+ *
+ * Each frequency f completes a whole number of cycles in AUDIO_FRAME_RATE / gcd(f,
+ * AUDIO_FRAME_RATE) samples, so a tone repeats exactly after the least common
+ * multiple of the periods of its two frequencies, which divides AUDIO_FRAME_RATE.
+ * When the samples of a tone are stored as they are without noise, they are
+ * therefore taken from a table of one period of the tone, converted to integers,
+ * which is computed by cos() the first time the tone is needed.  The phase is
+ * reduced modulo the period exactly, in integer arithmetic, so the table is at
+ * least as accurate as the oscillators.
+ */
+
+#define DTMF_SYNTH_LANES 4
+#define DTMF_SYNTH_SPAN 256
+
+/*
+ * Synthesize samples of a DTMF tone.
+ *
+ *   @param w_row  Angular frequency of the row tone, in radians per sample.
+ *   @param w_col  Angular frequency of the column tone, in radians per sample.
+ *   @param start  Index of the first sample to be synthesized.
+ *   @param n  Number of samples to be synthesized.
+ *   @param out  Array to receive the n samples, before conversion to integers.
+ */
+void dtmf_synth_span(double w_row, double w_col, uint32_t start, uint32_t n, double *out);
+
+/*
+ * Obtain the table of one period of a DTMF tone, as it is stored without noise:
+ * sample i of the tone is entry i % period of the table.  This may be called by
+ * several threads at once.
+ *
+ *   @param row  Index of the row frequency, in [0, NUM_DTMF_ROW_FREQS).
+ *   @param col  Index of the column frequency, in [0, NUM_DTMF_COL_FREQS).
+ *   @param periodp  Set to the number of samples in the period.
+ *   @return  The table, or NULL if storage could not be allocated.
+ */
+int16_t *dtmf_synth_table(int row, int col, uint32_t *periodp);
+
+#endif
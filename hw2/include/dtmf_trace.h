@@ -0,0 +1,103 @@
+#ifndef DTMF_TRACE_H
+#define DTMF_TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "dtmf.h"
+
+/*
+ * A trace of the analysis of each block by a DTMF detector, for seeing why tones
+ * are or are not detected: the energy of the block, the strengths of all eight
+ * frequencies, the strongest row and column frequencies and, if no symbol was
+ * found, which of the tests of dtmf_block_symbol() rejected the block.
+ *
+ * A trace is written in one of two formats.  The CSV format has a header line
+ * naming the columns
+ *
+ *   index,channel,energy,697,770,852,941,1209,1336,1477,1633,row,col,symbol,reason
+ *
+ * in which row and col are frequencies in Hz, symbol is empty if none was found,
+ * and reason is one of the names in dtmf_trace_reasons.  The binary format, which
+ * is much cheaper to write, begins with a DTMF_TRACE_HEADER, followed by one
+ * DTMF_TRACE_BLOCK per block, all in host byte order.
+ *
+ * The records are formatted into a large buffer, which is written out only when it
+ * is nearly full, so tracing adds little to the cost of analyzing a long file.
+ */
+
+/*
+ * Outcomes of the analysis of a block.
+ */
+#define DTMF_BLOCK_ACCEPTED 0      // A symbol was found.
+#define DTMF_BLOCK_SILENT 1        // Skipped by the silence gate.
+#define DTMF_BLOCK_WEAK 2          // Row and column together below MINUS_20DB.
+#define DTMF_BLOCK_TWIST 3         // Row and column not within FOUR_DB of each other.
+#define DTMF_BLOCK_ROW_MARGIN 4    // Another row frequency within SIX_DB of the strongest.
+#define DTMF_BLOCK_COL_MARGIN 5    // Another column frequency within SIX_DB of the strongest.
+#define DTMF_BLOCK_REASONS 6
+
+/*
+ * Names of the outcomes, as written in CSV traces.
+ */
+extern char *dtmf_trace_reasons[DTMF_BLOCK_REASONS];
+
+#define DTMF_TRACE_MAGIC "DTMFTRC1"
+#define DTMF_TRACE_BUFFER (1 << 20)
+
+/*
+ * The header of a binary trace.
+ */
+typedef struct dtmf_trace_header {
+    char magic[8];                      // DTMF_TRACE_MAGIC, without the null.
+    uint32_t block_size;                // Number of samples in each block.
+    uint32_t record_size;               // sizeof(DTMF_TRACE_BLOCK).
+} DTMF_TRACE_HEADER;
+
+/*
+ * The analysis of one block.
+ */
+typedef struct dtmf_trace_block {
+    uint32_t index;                     // Index of the first sample of the block.
+    uint16_t channel;                   // Channel analyzed, counting from 0.
+    uint8_t row;                        // Index of the strongest row frequency (0 to 3),
+    uint8_t col;                        // and column frequency (4 to 7).
+    uint8_t reason;                     // One of the DTMF_BLOCK_ outcomes.
+    char symbol;                        // The symbol found, or 0 if none.
+    uint8_t unused[2];
+    double energy;                      // Energy of the samples of the block.
+    double strengths[NUM_DTMF_FREQS];   // Strengths of the DTMF frequencies.
+} DTMF_TRACE_BLOCK;
+
+typedef struct dtmf_trace {
+    FILE *out;                          // Stream to which the trace is written.
+    int csv;                            // Nonzero for the CSV format.
+    char *buffer;                       // Records not yet written,
+    size_t fill;                        // and their length.
+    int error;                          // Nonzero once writing has failed.
+    uint32_t records;                   // Number of blocks traced.
+} DTMF_TRACE;
+
+/*
+ * Create a trace file.  The CSV format is used if the name ends in ".csv", the
+ * binary format otherwise.
+ *
+ *   @param path  Name of the file.
+ *   @param block_size  Number of samples in each block, recorded in a binary trace.
+ *   @return  The trace, or NULL if the file could not be created.
+ */
+DTMF_TRACE *dtmf_trace_open(char *path, uint32_t block_size);
+
+/*
+ * Add the analysis of a block to a trace.
+ */
+void dtmf_trace_block(DTMF_TRACE *tp, DTMF_TRACE_BLOCK *bp);
+
+/*
+ * Write out what remains of a trace and close it.
+ *
+ *   @return 0 if the whole trace was written successfully, EOF otherwise.
+ */
+int dtmf_trace_close(DTMF_TRACE *tp);
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef GOERTZEL_BANK_H
+#define GOERTZEL_BANK_H
+
+#include <stdint.h>
+
+#include "dtmf.h"
+#include "dtmf_plan.h"
+
+/*
+ * A Goertzel "filter bank" runs one instance of the Goertzel algorithm for
+ * each of the NUM_DTMF_FREQS frequencies over the same block of samples.
+ * Rather than stepping eight separate GOERTZEL_STATE structures once per sample,
+ * the s1/s2 state variables of all the filters are kept side by side in vectors
+ * (GCC vector extensions, so no particular instruction set is assumed), and a
+ * whole block of samples is pushed through the recurrence at once.
+ *
+ * The coefficients used by the filters come from a DTMF_PLAN, which may be
+ * shared between banks.  Each lane performs exactly the same floating point
+ * operations, in the same order, as goertzel_step() and goertzel_strength(),
+ * so the strengths computed by the bank are identical to those computed by
+ * separate GOERTZEL_STATE instances.
+ */
+typedef struct goertzel_bank {
+    DTMF_PLAN *plan;                     // Coefficients of the filters.
+    goertzel_vec s1[GOERTZEL_BANK_VECS]; // Filter state variables.
+    goertzel_vec s2[GOERTZEL_BANK_VECS];
+} GOERTZEL_BANK;
+
+/*
+ * Initialize a filter bank to use the coefficients in the specified plan.
+ *
+ *   @param bp  Pointer to the bank to be initialized.
+ *   @param pp  Plan giving the block size and filter coefficients.
+ */
+void goertzel_bank_init(GOERTZEL_BANK *bp, DTMF_PLAN *pp);
+
+/*
+ * Clear the state variables of all the filters in a bank, so that it can be
+ * used for the next block.
+ */
+void goertzel_bank_reset(GOERTZEL_BANK *bp);
+
+/*
+ * Run all the filters in a bank over a sequence of samples.
+ * The samples are expected to have been scaled to the range [-1.0, 1.0],
+ * as by audio_normalize_samples().
+ *
+ *   @param bp  Pointer to the bank.
+ *   @param x  Samples to be processed.
+ *   @param n  Number of samples to be processed.
+ */
+void goertzel_bank_step(GOERTZEL_BANK *bp, double *x, uint32_t n);
+
+/*
+ * Perform the final iteration for all the filters in a bank and store the
+ * resulting strengths (as would be returned by goertzel_strength()).
+ *
+ *   @param bp  Pointer to the bank.
+ *   @param x  The last sample of the block.
+ *   @param strengths  Array of NUM_DTMF_FREQS values to receive the strengths.
+ */
+void goertzel_bank_strengths(GOERTZEL_BANK *bp, double x, double *strengths);
+
+/*
+ * Convenience function that resets a bank, runs it over a complete block of
+ * N samples, and stores the resulting strengths.
+ */
+void goertzel_bank_block(GOERTZEL_BANK *bp, double *x, double *strengths);
+
+/*
+ * A "sliding" filter bank computes the output of each filter over a window of the
+ * N most recent samples, updating it as each sample enters the window and the
+ * oldest sample leaves it, so that the strengths may be obtained for windows that
+ * overlap, at a cost per sample that does not depend on how often they are wanted.
+ * For a window of N samples starting at index m, the output X_m of the filter for
+ * frequency index k (A = 2 * pi * k / N) is the sum of x[m + n] * exp(-j * A * n),
+ * whose magnitude is that of the Goertzel filter's output for the same samples.
+ * Moving the window by one sample gives
+ *
+ *   X_(m+1) = exp(j * A) * (X_m - x[m]) + x[m + N] * exp(-j * A * (N - 1)),
+ *
+ * in which both factors come from the plan (they are the conjugate of C, and D).
+ * The rounding errors of these updates accumulate, so the outputs should be
+ * recomputed from the samples in the window every so often.
+ */
+typedef struct goertzel_slide {
+    DTMF_PLAN *plan;                     // Coefficients of the filters.
+    goertzel_vec re[GOERTZEL_BANK_VECS]; // Filter outputs for the current window.
+    goertzel_vec im[GOERTZEL_BANK_VECS];
+} GOERTZEL_SLIDE;
+
+/*
+ * Initialize a sliding filter bank to use the coefficients in the specified plan,
+ * with a window containing only zero samples.
+ */
+void goertzel_slide_init(GOERTZEL_SLIDE *sp, DTMF_PLAN *pp);
+
+/*
+ * Move the window of a sliding filter bank along a sequence of samples.
+ *
+ *   @param sp  Pointer to the sliding bank.
+ *   @param x_in  Samples entering the window.
+ *   @param x_out  Samples leaving the window (those N samples before the ones in x_in),
+ *   or NULL if they are all zero.
+ *   @param n  Number of samples entering (and leaving) the window.
+ */
+void goertzel_slide_step(GOERTZEL_SLIDE *sp, double *x_in, double *x_out, uint32_t n);
+
+/*
+ * Store the strengths of the frequencies in the current window of a sliding bank,
+ * scaled in the same way as those returned by goertzel_strength().
+ *
+ *   @param sp  Pointer to the sliding bank.
+ *   @param strengths  Array of NUM_DTMF_FREQS values to receive the strengths.
+ */
+void goertzel_slide_strengths(GOERTZEL_SLIDE *sp, double *strengths);
+
+/*
+ * Compute the energy of a sequence of samples, that is, the sum of their squares.
+ * The sum is accumulated GOERTZEL_BANK_LANES samples at a time, so the result may
+ * differ in the last bits from a sum taken in sequence.
+ *
+ *   @param x  Samples, scaled as for goertzel_bank_step().
+ *   @param n  Number of samples.
+ *   @return  The energy of the samples.
+ */
+double goertzel_bank_energy(double *x, uint32_t n);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef GOERTZEL_FIXED_H
+#define GOERTZEL_FIXED_H
+
+#include <stdint.h>
+
+#include "dtmf.h"
+#include "dtmf_plan.h"
+
+/*
+ * Fixed-point version of the Goertzel filter bank, which works directly on the
+ * 16-bit samples read from the audio file instead of on samples converted to
+ * double and scaled to [-1.0, 1.0].
+ *
+ * The coefficient B = 2 * cos(A) of each filter is taken from the plan, rounded
+ * to GOERTZEL_FIXED_BITS fraction bits (so Q1.14 in a 32-bit lane, which is Q15 for
+ * cos(A) itself).  The state variables are 32-bit integers, and each product B * s1
+ * is formed in 64 bits and rounded back.  For a block of N samples the state can
+ * grow to at most N * INT16_MAX / sin(A), which is well within 32 bits for every
+ * block size the program accepts and every DTMF frequency; the products need no
+ * more than 47 bits.  The eight filters occupy one vector of 32-bit lanes.
+ *
+ * Only the final strengths are computed in floating point, from the last two state
+ * values, by |y|^2 = s1^2 + s2^2 - B * s1 * s2 (the phase of y is of no interest).
+ * They are scaled like those computed by goertzel_strength(), and differ from them
+ * only by the effects of rounding, which are far too small to change which symbol,
+ * if any, is found in a block unless a strength lies right at a threshold.
+ */
+
+/*
+ * Run all the filters in a bank over a complete block of N samples, as given by
+ * the plan, and store the resulting strengths.
+ *
+ *   @param pp  Plan giving the block size and filter coefficients.
+ *   @param x  Samples of the block, in host byte order.
+ *   @param strengths  Array of NUM_DTMF_FREQS values to receive the strengths.
+ */
+void goertzel_fixed_block(DTMF_PLAN *pp, int16_t *x, double *strengths);
+
+/*
+ * Compute the energy of a sequence of samples, scaled as goertzel_bank_energy()
+ * would for the same samples converted to double, but summed exactly in 64 bits.
+ *
+ *   @param x  Samples, in host byte order.
+ *   @param n  Number of samples, at most 2^32.
+ *   @return  The energy of the samples.
+ */
+double goertzel_fixed_energy(int16_t *x, uint32_t n);
+
+#endif
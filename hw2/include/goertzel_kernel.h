@@ -0,0 +1,33 @@
+#ifndef GOERTZEL_KERNEL_H
+#define GOERTZEL_KERNEL_H
+
+#include "dtmf_plan.h"
+
+/*
+ * Kernels specialized for the most common block sizes at AUDIO_FRAME_RATE: 100,
+ * 160, 205 and 256 samples.  For each of these, the loop of goertzel_bank_step()
+ * is compiled with the block size and the coefficients of the DTMF frequencies as
+ * constants, and fully unrolled, which removes the loop overhead and lets the
+ * compiler schedule the two halves of the bank across iterations.
+ *
+ * The coefficients are written with the same expressions as in dtmf_plan_create(),
+ * which the compiler evaluates, and each kernel performs exactly the same
+ * operations as goertzel_bank_step(), so the strengths computed with a kernel are
+ * identical to those computed without one.  As the compiler need not evaluate
+ * cos() exactly as the C library does, a kernel is only used for a plan whose
+ * coefficients it reproduces exactly; any other plan uses goertzel_bank_step().
+ *
+ * The fixed-point filters of goertzel_fixed.h are not specialized: their loop is
+ * limited by the 64-bit multiplications, and gains nothing from constant
+ * coefficients or unrolling.
+ */
+
+/*
+ * Set the kernel of a plan to the one specialized for its block size, sample rate
+ * and coefficients, or to NULL if there is none.
+ *
+ *   @param pp  The plan, whose coefficients have been computed.
+ */
+void goertzel_kernel_select(DTMF_PLAN *pp);
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef TONE_BANK_H
+#define TONE_BANK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Detection of tones other than DTMF: call-progress tones (dial, busy, ringback),
+ * fax calling and answer tones, MF R1 signalling and so on, as listed in a
+ * description read when the program starts.
+ *
+ * The description is a text file of lines of the following kinds, in which
+ * anything from a '#' to the end of the line is ignored:
+ *
+ *   block N
+ *       Analyze blocks of N samples (default TONE_DEFAULT_BLOCK), at the rate of
+ *       the audio analyzed.  The block must be long enough for the filters to
+ *       separate the closest frequencies of a family: at 8000 samples per second,
+ *       200 samples separate frequencies 40 Hz apart.
+ *   family NAME twist DB margin DB level DB
+ *       Start a family of tones, which compete with one another.  A tone of the
+ *       family is present in a block when the strengths of its frequencies
+ *       together reach the level (in dB, relative to the strength of a full-scale
+ *       sine wave, so that -20 is the threshold used for DTMF), its two
+ *       frequencies (if it has two) are within twist dB of each other, and each of
+ *       them exceeds every other frequency of the family by margin dB.
+ *   tone NAME FREQ [FREQ] MSEC
+ *       A tone of the current family, made up of one or two frequencies in Hz,
+ *       which is only reported if it lasts at least MSEC milliseconds.
+ *
+ * A block may contain at most one tone of each family, the first listed that is
+ * present, but tones of different families may be present at the same time.
+ *
+ * The filters for all the distinct frequencies of all the families are run over
+ * each block together, as a single bank of Goertzel filters whose state is held in
+ * vectors of TONE_BANK_LANES lanes, so every family is detected in the same pass
+ * over the samples (and the same pass as DTMF detection, when the bank is attached
+ * to a DTMF detector).
+ */
+
+#define TONE_BANK_LANES 4
+#define TONE_MAX_FREQS 32
+#define TONE_MAX_TONES 64
+#define TONE_MAX_FAMILIES 16
+#define TONE_NAME_SIZE 16
+#define TONE_DEFAULT_BLOCK 200
+
+typedef double tone_vec __attribute__ ((vector_size (TONE_BANK_LANES * sizeof(double))));
+
+/*
+ * One tone of a description.
+ */
+typedef struct tone_def {
+    char name[TONE_NAME_SIZE];   // Name written for each event.
+    int nfreqs;                  // Number of frequencies, 1 or 2.
+    int freqs[2];                // Their indices in the table of frequencies.
+    uint32_t min_ms;             // Minimum duration of an event, in milliseconds.
+    int family;                  // Index of the family of the tone.
+} TONE_DEF;
+
+/*
+ * One family of tones.
+ */
+typedef struct tone_family {
+    char name[TONE_NAME_SIZE];
+    double twist;                // Largest ratio of the strengths of a pair of frequencies.
+    double margin;               // Least ratio to the strength of any other frequency.
+    double level;                // Least total strength of the frequencies of a tone.
+    uint32_t members;            // Set (as bits) of the frequencies of its tones.
+} TONE_FAMILY;
+
+/*
+ * A description of the tones to be detected.
+ */
+typedef struct tone_spec {
+    uint32_t block_size;                      // Number of samples in each block.
+    int nfreqs;                               // Number of distinct frequencies.
+    int freqs[TONE_MAX_FREQS];                // The frequencies, in Hz.
+    int ntones;
+    TONE_DEF tones[TONE_MAX_TONES];           // The tones, family by family.
+    int nfamilies;
+    TONE_FAMILY families[TONE_MAX_FAMILIES];
+} TONE_SPEC;
+
+/*
+ * Read a description of tones.
+ *
+ *   @param path  Name of the file holding the description.
+ *   @return  The description, or NULL if the file could not be read or is not a
+ *   valid description (in which case a message is printed on the standard error).
+ */
+TONE_SPEC *tone_spec_load(char *path);
+
+/*
+ * Free a description of tones.
+ */
+void tone_spec_free(TONE_SPEC *sp);
+
+/*
+ * The function through which a tone bank reports a completed tone event, giving
+ * its name and the indices of its first sample and of the sample following its
+ * last.  It returns 0 if successful, EOF on error.
+ */
+typedef int (*TONE_EMIT)(void *arg, char *name, uint32_t start, uint32_t end);
+
+/*
+ * A tone bank holds the state of the detection of the tones of a description in a
+ * single stream of samples: the block being collected, the filter coefficients and
+ * the tone in progress, if any, in each family.
+ */
+typedef struct tone_bank {
+    TONE_SPEC *spec;                          // The tones to be detected.
+    uint32_t N;                               // Number of samples in each block.
+    int nvecs;                                // Number of vectors of filters.
+    tone_vec B[TONE_MAX_FREQS / TONE_BANK_LANES];  // 2 * cos(2 * pi * f / rate).
+    double NN;                                // N * N, by which the strengths are scaled.
+    uint32_t min_samples[TONE_MAX_TONES];     // Minimum duration of each tone, in samples.
+    double *block;                            // Scaled samples of the block being collected.
+    uint32_t fill;                            // Number of samples collected so far in the block.
+    uint32_t samples;                         // Total number of samples given to the bank.
+    double strengths[TONE_MAX_FREQS];         // Strengths computed for the most recent block.
+    int current[TONE_MAX_FAMILIES];           // Tone in progress in each family, or -1 if none.
+    uint32_t start[TONE_MAX_FAMILIES];        // Starting index of each tone in progress.
+    TONE_EMIT emit;                           // Called for each completed event.
+    void *arg;                                // Passed to emit.
+} TONE_BANK;
+
+/*
+ * Create a tone bank.
+ *
+ *   @param sp  The tones to be detected, which must remain valid while the bank is used.
+ *   @param rate  Sample rate of the samples, in samples per second.
+ *   @param emit  Function to be called for each completed event.
+ *   @param arg  Passed to emit.
+ *   @return  The new bank, or NULL if storage could not be allocated.
+ */
+TONE_BANK *tone_bank_create(TONE_SPEC *sp, uint32_t rate, TONE_EMIT emit, void *arg);
+
+/*
+ * Prepare a tone bank to analyze a new stream of samples.
+ */
+void tone_bank_reset(TONE_BANK *tp);
+
+/*
+ * Give samples to a tone bank.  Each time a complete block has been collected, it
+ * is analyzed, and the events completed by it are reported.
+ *
+ *   @param tp  The bank.
+ *   @param samples  Array of samples, in host byte order.
+ *   @param n  Number of samples.
+ *   @return 0 if successful, EOF if reporting an event failed.
+ */
+int tone_bank_feed(TONE_BANK *tp, int16_t *samples, size_t n);
+
+/*
+ * Signal the end of the samples to a tone bank, ending any tone still in progress
+ * at the index of the last sample given to the bank.  An incomplete final block is
+ * not analyzed.
+ *
+ *   @param tp  The bank.
+ *   @return 0 if successful, EOF if reporting an event failed.
+ */
+int tone_bank_finish(TONE_BANK *tp);
+
+/*
+ * Obtain the strengths of the frequencies (in the order of the description's table
+ * of frequencies) in the most recent complete block given to a tone bank.
+ */
+double *tone_bank_strengths(TONE_BANK *tp);
+
+void tone_bank_destroy(TONE_BANK *tp);
+
+#endif
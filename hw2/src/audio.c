@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <unistd.h>
 
 #include "audio.h"
+#include "audio_bulk.h"
+#include "audio_resample.h"
 #include "debug.h"
 
 int audio_read_sample(FILE *in, int16_t *samplep) {
@@ -28,59 +31,52 @@ int audio_write_sample(FILE *out, int16_t sample) {
     return 0;
 }
 
-uint32_t audio_reader_helper(FILE* in) {
-	int16_t a;
-	int16_t b;
+/*
+ * Value of the big-endian 32-bit field at the specified position.
+ */
+static uint32_t header_field(uint8_t *bytes) {
+	return ((uint32_t)*bytes << 24) | ((uint32_t)*(bytes + 1) << 16) |
+		((uint32_t)*(bytes + 2) << 8) | *(bytes + 3);
+}
+
+int audio_decode_header(uint8_t *bytes, AUDIO_HEADER *hp) {
+	hp->magic_number = header_field(bytes);
+	hp->data_offset = header_field(bytes + 4);
+	hp->data_size = header_field(bytes + 8);
+	hp->encoding = header_field(bytes + 12);
+	hp->sample_rate = header_field(bytes + 16);
+	hp->channels = header_field(bytes + 20);
 
-	if (audio_read_sample(in, &a) == EOF || audio_read_sample(in, &b) == EOF) {
+	if (hp->magic_number != AUDIO_MAGIC || !audio_encoding_bytes(hp->encoding) ||
+	    (hp->sample_rate != AUDIO_FRAME_RATE && !audio_decimator_supported(hp->sample_rate)) ||
+	    hp->channels < AUDIO_CHANNELS || hp->channels > AUDIO_MAX_CHANNELS) {
 		return EOF;
 	}
-
-	uint32_t sum_int = a;
-	sum_int <<= 16;
-	sum_int += (b & 0xffff);
-
-	return sum_int;
+	if (hp->data_offset < AUDIO_DATA_OFFSET) {
+		return EOF;
+	}
+	return 0;
 }
 
 int audio_read_header(FILE *in, AUDIO_HEADER *hp) {
-	uint32_t magic_number = audio_reader_helper(in);
-	uint32_t data_offset = audio_reader_helper(in);
-	uint32_t data_size = audio_reader_helper(in);
-	uint32_t encoding = audio_reader_helper(in);
-	uint32_t sample_rate = audio_reader_helper(in);
-	uint32_t channels = audio_reader_helper(in);
-
-	if (magic_number == EOF || data_offset == EOF || data_size == EOF || encoding == EOF || sample_rate == EOF || channels == EOF) {
+	uint8_t bytes[AUDIO_BULK_CHUNK];
+	if (fread(bytes, 1, AUDIO_DATA_OFFSET, in) != AUDIO_DATA_OFFSET) {
 		return EOF;
 	}
-	hp->magic_number = magic_number;
-	hp->data_offset = data_offset;
-	hp->data_size = data_size;
-	hp->encoding = encoding;
-	hp->sample_rate = sample_rate;
-	hp->channels = channels;
-
-	if (magic_number != AUDIO_MAGIC || encoding != PCM16_ENCODING || sample_rate != AUDIO_FRAME_RATE || channels != AUDIO_CHANNELS) {
-		// printf("%d\n", magic_number);
+	if (audio_decode_header(bytes, hp) == EOF) {
 		return EOF;
 	}
-	if (data_offset < 24) {
-		return -1;
-	}
-	// printf("%d %d %d %d %d \n", hp->data_offset, hp->data_size, hp->encoding, hp->sample_rate, hp->channels);
-
-	int num_left = hp->data_offset - 24;
 
+	// Skip the annotation field, which must be present in full.
+	size_t num_left = hp->data_offset - AUDIO_DATA_OFFSET;
 	while (num_left > 0) {
-		int a = fgetc(in);
-		if (a == EOF){
+		size_t count = num_left < sizeof(bytes) ? num_left : sizeof(bytes);
+		if (fread(bytes, 1, count, in) != count) {
 			return EOF;
 		}
-		num_left -= 1;
+		num_left -= count;
 	}
-
-    return 0;
+	return 0;
 }
 
 int audio_write_header_helper(uint32_t num, FILE* out) {
@@ -115,3 +111,189 @@ int audio_write_header(FILE *out, AUDIO_HEADER *hp) {
 	}
     return 0;
 }
+
+/*
+ * Vector types used by the bulk sample kernels.  The reduced alignment allows
+ * them to be loaded from and stored to arbitrary positions in sample arrays.
+ */
+typedef uint16_t pcm_vec __attribute__ ((vector_size (16), aligned (2)));
+typedef int16_t pcm_vec4 __attribute__ ((vector_size (8), aligned (2)));
+typedef double norm_vec4 __attribute__ ((vector_size (32), aligned (8)));
+
+/*
+ * The same, for big-endian samples at any byte address, as in a mapped file.
+ */
+typedef uint16_t pcm_bvec __attribute__ ((vector_size (16), aligned (1)));
+typedef uint16_t pcm_bvec4 __attribute__ ((vector_size (8), aligned (1)));
+typedef uint16_t pcm_uvec4 __attribute__ ((vector_size (8)));
+
+#define PCM_VEC_LEN (sizeof(pcm_vec) / sizeof(uint16_t))
+
+void audio_swap_samples(int16_t *src, int16_t *dst, size_t n) {
+	size_t i = 0;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	// File byte order is already the host byte order.
+	if (src != dst) {
+		for (; i < n; i++) {
+			*(dst + i) = *(src + i);
+		}
+	}
+#else
+	for (; i + PCM_VEC_LEN <= n; i += PCM_VEC_LEN) {
+		pcm_vec v = *(pcm_vec *)(src + i);
+		*(pcm_vec *)(dst + i) = (v << 8) | (v >> 8);
+	}
+	for (; i < n; i++) {
+		uint16_t v = *(src + i);
+		*(dst + i) = (v << 8) | (v >> 8);
+	}
+#endif
+}
+
+void audio_normalize_samples(int16_t *samples, double *x, size_t n) {
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		pcm_vec4 v = *(pcm_vec4 *)(samples + i);
+		*(norm_vec4 *)(x + i) = __builtin_convertvector(v, norm_vec4) / INT16_MAX;
+	}
+	for (; i < n; i++) {
+		*(x + i) = 1.0 * *(samples + i) / INT16_MAX;
+	}
+}
+
+size_t audio_read_samples(FILE *in, int16_t *samples, size_t n) {
+	size_t count = fread(samples, AUDIO_BYTES_PER_SAMPLE, n, in);
+	audio_swap_samples(samples, samples, count);
+	return count;
+}
+
+int audio_write_samples(FILE *out, int16_t *samples, size_t n) {
+	int16_t chunk[AUDIO_BULK_CHUNK];
+	while (n > 0) {
+		size_t count = n < AUDIO_BULK_CHUNK ? n : AUDIO_BULK_CHUNK;
+		audio_swap_samples(samples, chunk, count);
+		if (fwrite(chunk, AUDIO_BYTES_PER_SAMPLE, count, out) != count) {
+			return EOF;
+		}
+		samples += count;
+		n -= count;
+	}
+	return 0;
+}
+
+int audio_pwrite_samples(int fd, int16_t *samples, size_t n, off_t offset) {
+	int16_t chunk[AUDIO_BULK_CHUNK];
+	while (n > 0) {
+		size_t count = n < AUDIO_BULK_CHUNK ? n : AUDIO_BULK_CHUNK;
+		audio_swap_samples(samples, chunk, count);
+		size_t bytes = count * AUDIO_BYTES_PER_SAMPLE;
+		size_t done = 0;
+		while (done < bytes) {
+			ssize_t written = pwrite(fd, (char *)chunk + done, bytes - done, offset + done);
+			if (written <= 0) {
+				return EOF;
+			}
+			done += written;
+		}
+		samples += count;
+		offset += bytes;
+		n -= count;
+	}
+	return 0;
+}
+
+/*
+ * Value of the big-endian sample at the specified position.
+ */
+static int16_t be_sample(uint8_t *bytes) {
+	return (int16_t)(((uint16_t)*bytes << 8) | *(bytes + 1));
+}
+
+void audio_decode_samples(uint8_t *src, int16_t *dst, size_t n) {
+	size_t i = 0;
+#if __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	for (; i + PCM_VEC_LEN <= n; i += PCM_VEC_LEN) {
+		pcm_bvec v = *(pcm_bvec *)(src + i * AUDIO_BYTES_PER_SAMPLE);
+		*(pcm_vec *)(dst + i) = (v << 8) | (v >> 8);
+	}
+#endif
+	for (; i < n; i++) {
+		*(dst + i) = be_sample(src + i * AUDIO_BYTES_PER_SAMPLE);
+	}
+}
+
+void audio_normalize_be_samples(uint8_t *src, double *x, size_t n) {
+	size_t i = 0;
+#if __BYTE_ORDER__ != __ORDER_BIG_ENDIAN__
+	for (; i + 4 <= n; i += 4) {
+		pcm_uvec4 v = *(pcm_bvec4 *)(src + i * AUDIO_BYTES_PER_SAMPLE);
+		v = (v << 8) | (v >> 8);
+		pcm_vec4 s = (pcm_vec4)v;
+		*(norm_vec4 *)(x + i) = __builtin_convertvector(s, norm_vec4) / INT16_MAX;
+	}
+#endif
+	for (; i < n; i++) {
+		*(x + i) = 1.0 * be_sample(src + i * AUDIO_BYTES_PER_SAMPLE) / INT16_MAX;
+	}
+}
+
+size_t audio_encoding_bytes(uint32_t encoding) {
+	switch (encoding) {
+	case PCM16_ENCODING:
+		return AUDIO_BYTES_PER_SAMPLE;
+	case MULAW_ENCODING:
+	case ALAW_ENCODING:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Decode samples in an 8-bit encoding by table lookup.
+ */
+static void decode_g711(uint8_t *src, const int16_t *table, int16_t *dst, size_t n) {
+	for (size_t i = 0; i < n; i++) {
+		*(dst + i) = *(table + *(src + i));
+	}
+}
+
+size_t audio_read_encoded(FILE *in, uint32_t encoding, int16_t *samples, size_t n) {
+	if (encoding == PCM16_ENCODING) {
+		return audio_read_samples(in, samples, n);
+	}
+	// One byte per sample: read the codes a chunk at a time and look them up.
+	uint8_t codes[AUDIO_BULK_CHUNK];
+	size_t total = 0;
+	while (total < n) {
+		size_t want = n - total < AUDIO_BULK_CHUNK ? n - total : AUDIO_BULK_CHUNK;
+		size_t count = fread(codes, 1, want, in);
+		audio_decode_encoded(codes, encoding, samples + total, count);
+		total += count;
+		if (count < want) {
+			break;
+		}
+	}
+	return total;
+}
+
+void audio_decode_encoded(uint8_t *src, uint32_t encoding, int16_t *dst, size_t n) {
+	if (encoding == MULAW_ENCODING) {
+		decode_g711(src, audio_mulaw_table, dst, n);
+	} else if (encoding == ALAW_ENCODING) {
+		decode_g711(src, audio_alaw_table, dst, n);
+	} else {
+		audio_decode_samples(src, dst, n);
+	}
+}
+
+void audio_normalize_encoded(uint8_t *src, uint32_t encoding, double *x, size_t n) {
+	if (encoding == PCM16_ENCODING) {
+		audio_normalize_be_samples(src, x, n);
+		return;
+	}
+	const int16_t *table = encoding == MULAW_ENCODING ? audio_mulaw_table : audio_alaw_table;
+	for (size_t i = 0; i < n; i++) {
+		*(x + i) = 1.0 * *(table + *(src + i)) / INT16_MAX;
+	}
+}
@@ -0,0 +1,49 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "audio_bulk.h"
+#include "audio_map.h"
+#include "debug.h"
+
+int audio_map_open(AUDIO_MAP *mp, FILE *in) {
+	struct stat st;
+	int fd = fileno(in);
+	off_t start = ftello(in);
+	if (fd < 0 || start < 0 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode) ||
+	    st.st_size <= start) {
+		return EOF;
+	}
+	void *base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (base == MAP_FAILED) {
+		return EOF;
+	}
+	madvise(base, st.st_size, MADV_SEQUENTIAL);
+	mp->base = base;
+	mp->length = st.st_size;
+	mp->start = start;
+	mp->data = NULL;
+	mp->nsamples = 0;
+	mp->encoding = PCM16_ENCODING;
+	return 0;
+}
+
+int audio_map_read_header(AUDIO_MAP *mp, AUDIO_HEADER *hp) {
+	size_t avail = mp->length - mp->start;
+	uint8_t *audio = mp->base + mp->start;
+	if (avail < AUDIO_DATA_OFFSET || audio_decode_header(audio, hp) == EOF ||
+	    avail < hp->data_offset) {
+		return EOF;
+	}
+	mp->data = audio + hp->data_offset;
+	mp->nsamples = (avail - hp->data_offset) / audio_encoding_bytes(hp->encoding);
+	mp->encoding = hp->encoding;
+	debug("Mapped %zu samples at offset %u", mp->nsamples, hp->data_offset);
+	return 0;
+}
+
+void audio_map_close(AUDIO_MAP *mp) {
+	munmap(mp->base, mp->length);
+	mp->base = NULL;
+}
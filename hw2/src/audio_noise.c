@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "audio_bulk.h"
+#include "audio_map.h"
+#include "audio_noise.h"
+#include "debug.h"
+
+typedef double mix_vec __attribute__ ((vector_size (4 * sizeof(double))));
+typedef double mix_uvec __attribute__ ((vector_size (sizeof(mix_vec)), aligned (sizeof(double))));
+typedef int16_t mix_pcm_vec __attribute__ ((vector_size (4 * sizeof(int16_t)), aligned (sizeof(int16_t))));
+typedef int32_t mix_int_vec __attribute__ ((vector_size (4 * sizeof(int32_t))));
+
+/*
+ * The noise held for reuse, if any.
+ */
+static AUDIO_NOISE *noise_cache;
+
+/*
+ * Number of samples by which the buffer grows when a noise stream is read.
+ */
+#define NOISE_READ_CHUNK 65536
+
+/*
+ * Decode the samples of a mapped noise file.
+ */
+static int noise_load_mapped(AUDIO_NOISE *np, AUDIO_MAP *mp) {
+	AUDIO_HEADER header;
+	if (audio_map_read_header(mp, &header) == EOF || header.sample_rate != AUDIO_FRAME_RATE ||
+	    header.channels != AUDIO_CHANNELS) {
+		return EOF;
+	}
+	np->samples = malloc((mp->nsamples ? mp->nsamples : 1) * sizeof(int16_t));
+	if (!np->samples) {
+		return EOF;
+	}
+	audio_decode_encoded(mp->data, mp->encoding, np->samples, mp->nsamples);
+	np->nsamples = mp->nsamples;
+	return 0;
+}
+
+/*
+ * Read the samples of a noise stream that cannot be mapped.
+ */
+static int noise_load_stream(AUDIO_NOISE *np, FILE *in) {
+	AUDIO_HEADER header;
+	if (audio_read_header(in, &header) == EOF || header.sample_rate != AUDIO_FRAME_RATE ||
+	    header.channels != AUDIO_CHANNELS) {
+		return EOF;
+	}
+	size_t size = 0;
+	for (;;) {
+		int16_t *samples = realloc(np->samples, (size + NOISE_READ_CHUNK) * sizeof(int16_t));
+		if (!samples) {
+			return EOF;
+		}
+		np->samples = samples;
+		size += NOISE_READ_CHUNK;
+		size_t count = audio_read_encoded(in, header.encoding, np->samples + np->nsamples,
+						  size - np->nsamples);
+		np->nsamples += count;
+		if (np->nsamples < size) {
+			return 0;
+		}
+	}
+}
+
+/*
+ * Whether held noise came from the file described.
+ */
+static int noise_matches(AUDIO_NOISE *np, struct stat *st) {
+	return np->dev == st->st_dev && np->ino == st->st_ino && np->size == st->st_size &&
+		np->mtime.tv_sec == st->st_mtim.tv_sec && np->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+AUDIO_NOISE *audio_noise_open(char *path) {
+	FILE *in = fopen(path, "r");
+	if (!in) {
+		return NULL;
+	}
+	struct stat st;
+	int regular = fstat(fileno(in), &st) == 0 && S_ISREG(st.st_mode);
+	if (regular && noise_cache && noise_matches(noise_cache, &st)) {
+		debug("Reusing %zu samples of noise from %s", noise_cache->nsamples, path);
+		fclose(in);
+		return noise_cache;
+	}
+
+	AUDIO_NOISE *np = calloc(1, sizeof(AUDIO_NOISE));
+	if (!np) {
+		fclose(in);
+		return NULL;
+	}
+	AUDIO_MAP map;
+	int ret;
+	if (audio_map_open(&map, in) == 0) {
+		ret = noise_load_mapped(np, &map);
+		audio_map_close(&map);
+	} else {
+		ret = noise_load_stream(np, in);
+	}
+	fclose(in);
+	if (ret == EOF) {
+		free(np->samples);
+		free(np);
+		return NULL;
+	}
+	debug("Loaded %zu samples of noise from %s", np->nsamples, path);
+
+	// Only a regular file can be recognized when it is asked for again.
+	if (regular) {
+		np->dev = st.st_dev;
+		np->ino = st.st_ino;
+		np->size = st.st_size;
+		np->mtime = st.st_mtim;
+		np->cached = 1;
+		if (noise_cache) {
+			free(noise_cache->samples);
+			free(noise_cache);
+		}
+		noise_cache = np;
+	}
+	return np;
+}
+
+void audio_noise_close(AUDIO_NOISE *np) {
+	if (np && !np->cached) {
+		free(np->samples);
+		free(np);
+	}
+}
+
+void audio_noise_mix(double *x, int16_t *noise, size_t n, double w, int16_t *out) {
+	double v = 1 - w;
+	size_t i = 0;
+	if (noise) {
+		for (; i + 4 <= n; i += 4) {
+			mix_vec y = __builtin_convertvector(*(mix_pcm_vec *)(noise + i), mix_vec);
+			mix_int_vec z = __builtin_convertvector(*(mix_uvec *)(x + i) * v + y * w, mix_int_vec);
+			*(mix_pcm_vec *)(out + i) = __builtin_convertvector(z, mix_pcm_vec);
+		}
+		for (; i < n; i++) {
+			int z = *(x + i) * v + *(noise + i) * w;
+			*(out + i) = z;
+		}
+	} else {
+		for (; i + 4 <= n; i += 4) {
+			mix_int_vec z = __builtin_convertvector(*(mix_uvec *)(x + i) * v, mix_int_vec);
+			*(mix_pcm_vec *)(out + i) = __builtin_convertvector(z, mix_pcm_vec);
+		}
+		for (; i < n; i++) {
+			int z = *(x + i) * v;
+			*(out + i) = z;
+		}
+	}
+}
+
+int audio_mixer_init(AUDIO_MIXER *mp, FILE *out, char *noise_path, double w) {
+	audio_mixer_init_at(mp, -1, 0, NULL, w, 0);
+	mp->out = out;
+	if (noise_path) {
+		mp->owns_noise = 1;
+		mp->noise = audio_noise_open(noise_path);
+		if (!mp->noise) {
+			return EOF;
+		}
+	}
+	return 0;
+}
+
+void audio_mixer_init_at(AUDIO_MIXER *mp, int fd, off_t offset, AUDIO_NOISE *noise,
+			 double w, size_t position) {
+	mp->out = NULL;
+	mp->fd = fd;
+	mp->offset = offset;
+	mp->noise = noise;
+	mp->owns_noise = 0;
+	mp->w = w;
+	mp->position = position;
+	mp->count = 0;
+}
+
+double *audio_mixer_space(AUDIO_MIXER *mp, size_t *room) {
+	*room = AUDIO_BULK_CHUNK - mp->count;
+	return mp->samples + mp->count;
+}
+
+int audio_mixer_commit(AUDIO_MIXER *mp, size_t n) {
+	if (!mp->noise) {
+		// Without noise the samples are converted as they come, so that they may be
+		// mixed with samples committed as integers.
+		double *x = mp->samples + mp->count;
+		int16_t *out = mp->mixed + mp->count;
+		size_t i = 0;
+		for (; i + 4 <= n; i += 4) {
+			mix_int_vec z = __builtin_convertvector(*(mix_uvec *)(x + i), mix_int_vec);
+			*(mix_pcm_vec *)(out + i) = __builtin_convertvector(z, mix_pcm_vec);
+		}
+		for (; i < n; i++) {
+			*(out + i) = *(x + i);
+		}
+	}
+	mp->count += n;
+	if (mp->count == AUDIO_BULK_CHUNK) {
+		return audio_mixer_flush(mp);
+	}
+	return 0;
+}
+
+int16_t *audio_mixer_pcm_space(AUDIO_MIXER *mp, size_t *room) {
+	*room = AUDIO_BULK_CHUNK - mp->count;
+	return mp->mixed + mp->count;
+}
+
+int audio_mixer_commit_pcm(AUDIO_MIXER *mp, size_t n) {
+	mp->count += n;
+	if (mp->count == AUDIO_BULK_CHUNK) {
+		return audio_mixer_flush(mp);
+	}
+	return 0;
+}
+
+int audio_mixer_flush(AUDIO_MIXER *mp) {
+	size_t n = mp->count;
+	if (mp->noise) {
+		// The part of the buffer for which there is noise, then the rest.
+		size_t avail = mp->position < mp->noise->nsamples ? mp->noise->nsamples - mp->position : 0;
+		size_t k = avail < n ? avail : n;
+		if (k > 0) {
+			audio_noise_mix(mp->samples, mp->noise->samples + mp->position, k, mp->w, mp->mixed);
+		}
+		audio_noise_mix(mp->samples + k, NULL, n - k, mp->w, mp->mixed + k);
+	}
+	size_t position = mp->position;
+	mp->position += n;
+	mp->count = 0;
+	if (!mp->out) {
+		return audio_pwrite_samples(mp->fd, mp->mixed, n,
+					    mp->offset + (off_t)position * AUDIO_BYTES_PER_SAMPLE);
+	}
+	return audio_write_samples(mp->out, mp->mixed, n);
+}
+
+void audio_mixer_fini(AUDIO_MIXER *mp) {
+	if (mp->owns_noise) {
+		audio_noise_close(mp->noise);
+	}
+	mp->noise = NULL;
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "audio_pipe.h"
+#include "debug.h"
+
+/*
+ * Body of the reader thread: fill the buffers in turn until EOF, waiting whenever
+ * every buffer is full.
+ */
+static void *pipe_reader(void *arg) {
+	AUDIO_PIPE *pp = arg;
+	pthread_mutex_lock(&pp->mutex);
+	while (!pp->stop) {
+		if (pp->count == pp->depth) {
+			pp->reader_stalls += 1;
+		}
+		while (pp->count == pp->depth && !pp->stop) {
+			pthread_cond_wait(&pp->released, &pp->mutex);
+		}
+		if (pp->stop) {
+			break;
+		}
+		// The buffer at head is not in use, so it can be filled without the lock.
+		int slot = pp->head;
+		pthread_mutex_unlock(&pp->mutex);
+		size_t n = fread(*(pp->buffers + slot), 1, pp->buffer_size, pp->in);
+		pthread_mutex_lock(&pp->mutex);
+		if (n > 0) {
+			*(pp->lengths + slot) = n;
+			pp->head = (slot + 1) % pp->depth;
+			pp->count += 1;
+			pp->bytes += n;
+			pp->reads += 1;
+			pthread_cond_signal(&pp->filled);
+		}
+		if (n < pp->buffer_size) {
+			break;
+		}
+	}
+	pp->eof = 1;
+	pthread_cond_signal(&pp->filled);
+	pthread_mutex_unlock(&pp->mutex);
+	return NULL;
+}
+
+static void pipe_free(AUDIO_PIPE *pp) {
+	for (int i = 0; pp->buffers && i < pp->depth; i++) {
+		free(*(pp->buffers + i));
+	}
+	free(pp->buffers);
+	free(pp->lengths);
+	free(pp);
+}
+
+AUDIO_PIPE *audio_pipe_open(FILE *in, size_t frame_bytes, int depth) {
+	if (depth < AUDIO_PIPE_MIN_DEPTH || depth > AUDIO_PIPE_MAX_DEPTH || frame_bytes == 0 ||
+	    frame_bytes > AUDIO_PIPE_BUFFER) {
+		return NULL;
+	}
+	AUDIO_PIPE *pp = calloc(1, sizeof(AUDIO_PIPE));
+	if (!pp) {
+		return NULL;
+	}
+	pp->in = in;
+	pp->buffer_size = AUDIO_PIPE_BUFFER / frame_bytes * frame_bytes;
+	pp->depth = depth;
+	pp->buffers = calloc(depth, sizeof(uint8_t *));
+	pp->lengths = calloc(depth, sizeof(size_t));
+	if (!pp->buffers || !pp->lengths) {
+		pipe_free(pp);
+		return NULL;
+	}
+	for (int i = 0; i < depth; i++) {
+		if (!(*(pp->buffers + i) = malloc(pp->buffer_size))) {
+			pipe_free(pp);
+			return NULL;
+		}
+	}
+	pthread_mutex_init(&pp->mutex, NULL);
+	pthread_cond_init(&pp->filled, NULL);
+	pthread_cond_init(&pp->released, NULL);
+	if (pthread_create(&pp->reader, NULL, pipe_reader, pp) != 0) {
+		pthread_mutex_destroy(&pp->mutex);
+		pthread_cond_destroy(&pp->filled);
+		pthread_cond_destroy(&pp->released);
+		pipe_free(pp);
+		return NULL;
+	}
+	return pp;
+}
+
+size_t audio_pipe_next(AUDIO_PIPE *pp, uint8_t **datap) {
+	pthread_mutex_lock(&pp->mutex);
+	if (pp->holding) {
+		pp->tail = (pp->tail + 1) % pp->depth;
+		pp->count -= 1;
+		pp->holding = 0;
+		pthread_cond_signal(&pp->released);
+	}
+	if (pp->count == 0 && !pp->eof) {
+		pp->consumer_stalls += 1;
+	}
+	while (pp->count == 0 && !pp->eof) {
+		pthread_cond_wait(&pp->filled, &pp->mutex);
+	}
+	size_t n = 0;
+	if (pp->count > 0) {
+		*datap = *(pp->buffers + pp->tail);
+		n = *(pp->lengths + pp->tail);
+		pp->holding = 1;
+	}
+	pthread_mutex_unlock(&pp->mutex);
+	return n;
+}
+
+void audio_pipe_close(AUDIO_PIPE *pp, FILE *report) {
+	pthread_mutex_lock(&pp->mutex);
+	pp->stop = 1;
+	pthread_cond_signal(&pp->released);
+	pthread_mutex_unlock(&pp->mutex);
+	pthread_join(pp->reader, NULL);
+	debug("Read %lu bytes in %u buffers; reader stalled %u times, consumer %u times",
+	      (unsigned long)pp->bytes, pp->reads, pp->reader_stalls, pp->consumer_stalls);
+	if (report) {
+		fprintf(report, "queue: read %lu bytes in %u buffers; reader waited %u times, "
+			"detector %u times\n", (unsigned long)pp->bytes, pp->reads,
+			pp->reader_stalls, pp->consumer_stalls);
+	}
+	pthread_mutex_destroy(&pp->mutex);
+	pthread_cond_destroy(&pp->filled);
+	pthread_cond_destroy(&pp->released);
+	pipe_free(pp);
+}
@@ -0,0 +1,170 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "audio.h"
+#include "audio_resample.h"
+#include "debug.h"
+
+typedef double resample_vec __attribute__ ((vector_size (4 * sizeof(double))));
+typedef double resample_uvec __attribute__ ((vector_size (sizeof(resample_vec)), aligned (sizeof(double))));
+
+static uint32_t gcd(uint32_t a, uint32_t b) {
+	while (b) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+int audio_decimator_supported(uint32_t rate) {
+	return rate > AUDIO_FRAME_RATE && rate <= DECIMATOR_MAX_RATE &&
+		AUDIO_FRAME_RATE / gcd(AUDIO_FRAME_RATE, rate) <= DECIMATOR_MAX_L;
+}
+
+/*
+ * Compute the taps of the filter, at the upsampled rate, and distribute them among
+ * the phases.  Tap j of the filter applies to the upsampled sample j places before
+ * the one being computed; in phase p, tap p + k * L applies to the input sample k
+ * places before the most recent one used, and is stored taps - 1 - k places from
+ * the start of the phase, so that the taps are in the same order as the samples.
+ */
+static void design_filter(AUDIO_DECIMATOR *dp) {
+	uint32_t n = dp->L * dp->taps;
+	double fc = (double)AUDIO_FRAME_RATE / 2 / ((double)AUDIO_FRAME_RATE * dp->M);
+	for (uint32_t j = 0; j < n; j++) {
+		double t = (double)j - dp->center;
+		double sinc = t == 0 ? 2 * fc : sin(2 * M_PI * fc * t) / (M_PI * t);
+		double window = 0.42 + 0.5 * cos(2 * M_PI * t / n) + 0.08 * cos(4 * M_PI * t / n);
+		uint32_t phase = j % dp->L, k = j / dp->L;
+		*(dp->coeffs + phase * dp->taps + dp->taps - 1 - k) = dp->L * sinc * window;
+	}
+}
+
+AUDIO_DECIMATOR *audio_decimator_create(uint32_t rate) {
+	if (!audio_decimator_supported(rate)) {
+		debug("Cannot convert a sample rate of %u", rate);
+		return NULL;
+	}
+	AUDIO_DECIMATOR *dp = calloc(1, sizeof(AUDIO_DECIMATOR));
+	if (!dp) {
+		return NULL;
+	}
+	uint32_t g = gcd(AUDIO_FRAME_RATE, rate);
+	dp->L = AUDIO_FRAME_RATE / g;
+	dp->M = rate / g;
+	dp->taps = (uint32_t)ceil(5.5 * rate / DECIMATOR_TRANSITION);
+	dp->taps = (dp->taps + 3) / 4 * 4;
+	dp->center = (uint64_t)dp->L * dp->taps / 2;
+	dp->capacity = 2 * dp->taps + DECIMATOR_CHUNK;
+	dp->coeffs = malloc((size_t)dp->L * dp->taps * sizeof(double));
+	dp->history = malloc(dp->capacity * sizeof(double));
+	if (!dp->coeffs || !dp->history) {
+		audio_decimator_destroy(dp);
+		return NULL;
+	}
+	design_filter(dp);
+	audio_decimator_reset(dp);
+	return dp;
+}
+
+void audio_decimator_reset(AUDIO_DECIMATOR *dp) {
+	// The input is taken to be silent before it starts.
+	dp->count = dp->taps - 1;
+	dp->base = -(int64_t)dp->count;
+	for (size_t i = 0; i < dp->count; i++) {
+		*(dp->history + i) = 0;
+	}
+	dp->inputs = 0;
+	dp->outputs = 0;
+}
+
+/*
+ * Index of the most recent input sample used by the next output sample, and the
+ * phase of the filter that applies.
+ */
+static int64_t next_input(AUDIO_DECIMATOR *dp, uint32_t *phasep) {
+	uint64_t p = dp->outputs * dp->M + dp->center;
+	*phasep = p % dp->L;
+	return p / dp->L;
+}
+
+/*
+ * Discard the samples of the history that no further output sample uses.
+ */
+static void compact(AUDIO_DECIMATOR *dp) {
+	uint32_t phase;
+	int64_t first = next_input(dp, &phase) - dp->taps + 1;
+	if (first <= dp->base) {
+		return;
+	}
+	size_t drop = first - dp->base;
+	if (drop > dp->count) {
+		drop = dp->count;
+	}
+	for (size_t i = drop; i < dp->count; i++) {
+		*(dp->history + i - drop) = *(dp->history + i);
+	}
+	dp->count -= drop;
+	dp->base += drop;
+}
+
+/*
+ * Produce output samples, as long as the input samples they use are in the history
+ * and there are fewer than limit output samples in all.
+ */
+static size_t produce(AUDIO_DECIMATOR *dp, uint64_t limit, int16_t *out) {
+	size_t n = 0;
+	while (dp->outputs < limit) {
+		uint32_t phase;
+		int64_t last = next_input(dp, &phase);
+		if (last >= dp->base + (int64_t)dp->count) {
+			break;
+		}
+		double *x = dp->history + (last - dp->taps + 1 - dp->base);
+		double *h = dp->coeffs + (size_t)phase * dp->taps;
+		resample_vec acc = { 0 };
+		for (uint32_t k = 0; k < dp->taps; k += 4) {
+			acc += *(resample_uvec *)(x + k) * *(resample_uvec *)(h + k);
+		}
+		double v = 0.5;
+		for (int l = 0; l < 4; l++) {
+			v += *((double *)&acc + l);
+		}
+		v = floor(v);
+		*(out + n++) = v > INT16_MAX ? INT16_MAX : v < INT16_MIN ? INT16_MIN : (int16_t)v;
+		dp->outputs++;
+	}
+	return n;
+}
+
+size_t audio_decimator_run(AUDIO_DECIMATOR *dp, int16_t *in, size_t n, int16_t *out) {
+	compact(dp);
+	for (size_t i = 0; i < n; i++) {
+		*(dp->history + dp->count + i) = *(in + i);
+	}
+	dp->count += n;
+	dp->inputs += n;
+	return produce(dp, UINT64_MAX, out);
+}
+
+size_t audio_decimator_finish(AUDIO_DECIMATOR *dp, int16_t *out) {
+	compact(dp);
+	for (size_t i = 0; i < dp->taps; i++) {
+		*(dp->history + dp->count + i) = 0;
+	}
+	dp->count += dp->taps;
+	uint64_t total = (dp->inputs * dp->L + dp->M - 1) / dp->M;
+	return produce(dp, total, out);
+}
+
+void audio_decimator_destroy(AUDIO_DECIMATOR *dp) {
+	if (!dp) {
+		return;
+	}
+	free(dp->coeffs);
+	free(dp->history);
+	free(dp);
+}
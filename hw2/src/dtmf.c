@@ -3,10 +3,18 @@
 #include <math.h>
 
 #include "const.h"
+#include "dtmf_options.h"
 #include "audio.h"
+#include "audio_bulk.h"
+#include "audio_noise.h"
 #include "dtmf.h"
 #include "dtmf_static.h"
 #include "goertzel.h"
+#include "dtmf_synth.h"
+#include "dtmf_events.h"
+#include "dtmf_detector.h"
+#include "dtmf_channels.h"
+#include "dtmf_trace.h"
 #include "debug.h"
 
 #ifdef _STRING_H
@@ -121,141 +129,56 @@ int char_to_int(char c) {
  *  @return 0 if the header and specified number of samples are written successfully,
  *  EOF otherwise.
  */
-AUDIO_HEADER empty_header;
 int dtmf_generate(FILE *events_in, FILE *audio_out, uint32_t length) {
-	int starting = 0;
-	int ending = 0;
-	int row_freq = 0;
-	int col_freq = 0;
-	double pi = M_PI;
-	double audio_frame_rate = 8000;
-
-	empty_header.magic_number = AUDIO_MAGIC;
-	empty_header.data_offset = 24;
-	empty_header.data_size = length * 2;
-	empty_header.encoding = 3;
-	empty_header.sample_rate = 8000;
-	empty_header.channels = 1;
-
-	double angular_row_freq;
-	double angular_col_freq;	
+	AUDIO_HEADER header;
+	header.magic_number = AUDIO_MAGIC;
+	header.data_offset = 24;
+	header.data_size = length * 2;
+	header.encoding = 3;
+	header.sample_rate = 8000;
+	header.channels = 1;
 
 	double temp = pow(10, noise_level/10.0);
 	double w = temp/(1.0+temp);
 
 
-	if (audio_write_header(audio_out, &empty_header) == EOF) {
+	if (audio_write_header(audio_out, &header) == EOF) {
 		return EOF;
 	}
 
 
-	FILE* opened_file = 0;
-	if (noise_file) {
-		opened_file = fopen(noise_file, "r");
-		if (!opened_file) {
-			return EOF;
-		}
-		if (audio_read_header(opened_file, &empty_header) == EOF) {
-			return EOF;
-		}
+	// Noise is mixed in, and samples written, a buffer at a time.
+	AUDIO_MIXER mixer;
+	if (audio_mixer_init(&mixer, audio_out, noise_file, w) == EOF) {
+		return EOF;
 	}
 
-
-	for (int i = 0; i < length; i++) {
-		double dtmf = 0;
-		if ((i==0) || (i >= ending)) {
-			starting = 0;
-			char a = fgetc(events_in);
-			if (a != EOF) {
-				while(a != '\t') {
-					if (a == EOF) { 
-						break; }
-					if (char_to_int(a) == -1) {
-						return EOF;
-					}
-					starting = starting * 10 + char_to_int(a);
-					a = fgetc(events_in);
-				}
-				if(starting<ending){
-					return -1;
-				}
-
-				ending = 0;
-
-				a = fgetc(events_in);
-				while(a != '\t') {
-					if (a == EOF) { 
-						break; }
-					if (char_to_int(a) == -1) {
-						return EOF;
-					}
-					ending = ending * 10 + char_to_int(a);
-					a = fgetc(events_in);
-				}
-
-				if((starting>ending)|| (starting>length)||(ending>length)){
-					return -1;
-				}
-
-				a = fgetc(events_in);
-				if (a == EOF) {return EOF; }
-				row_freq = get_frequency(a,0);
-				col_freq = get_frequency(a,1);
-				if (row_freq == -1 || col_freq == -1) {
-					return EOF;
-				}
-
-				fgetc(events_in); // Get rid of \n
-				if (a == EOF) { return EOF; }
-
-				angular_row_freq = 2.0*M_PI*row_freq/audio_frame_rate;
-				angular_col_freq = 2.0*M_PI*col_freq/audio_frame_rate;
-			}
-		}
-		if (i >= starting && i < ending) {
-			double a = cos(angular_row_freq*i)*0.5;
-			double b = cos(angular_col_freq*i)*0.5;
-			//double c = (a * 0.5) + (b * 0.5);
-			dtmf = (a+b) * INT16_MAX;
-		}
-		if (opened_file) {
-			int16_t i_real;
-			int i = audio_read_sample(opened_file, &i_real);
-			if (i != EOF) {
-				int z = dtmf * (1 - w) + i_real * w;
-				dtmf = z;
-			}
-			else{
-				int z = dtmf*(1-w);
-				dtmf = z;
-			}
+	// Events are parsed a chunk at a time, and each stretch of silence and each
+	// tone is then generated as a whole.
+	DTMF_EVENT_READER reader;
+	dtmf_events_init(&reader, events_in, length);
+	uint32_t i = 0;
+	while (i < length && !reader.done) {
+		if (dtmf_events_read(&reader) == EOF) {
+			audio_mixer_fini(&mixer);
+			return EOF;
 		}
-
-		int16_t dtmf_int = dtmf;
-		if(audio_write_sample(audio_out, dtmf_int)==EOF){
+		uint32_t end = reader.count ? (reader.events + reader.count - 1)->end : i;
+		if (dtmf_events_render(&mixer, reader.events, reader.count, i, end) == EOF) {
+			audio_mixer_fini(&mixer);
 			return EOF;
 		}
-		//dtmf_generate_helper(dtmf_int, audio_out);
+		i = end;
+	}
+	// Silence runs from the last event to the end.
+	if (dtmf_events_render(&mixer, NULL, 0, i, length) == EOF) {
+		audio_mixer_fini(&mixer);
+		return EOF;
 	}
 
-    return 0;
-}
-
-int i_to_freq(int i) {
-	if (i == 0) {return 	697; }
-	if (i == 1) {return 	770; }
-	if (i == 2) {return 	852; }
-	if (i == 3) {return 	941; }
-	if (i == 4) {return 	1209; }
-	if (i == 5) {return 	1336; }
-	if (i == 6) {return 	1477; }
-	if (i == 7) {return 	1633; }
-	return -1;
-}
-
-char row_col_to_char(int i, int j) {
-	char c = *(j+*(i + dtmf_symbol_names));
-	return c;
+	int ret = audio_mixer_flush(&mixer);
+	audio_mixer_fini(&mixer);
+	return ret;
 }
 
 /**
@@ -283,141 +206,83 @@ char row_col_to_char(int i, int j) {
  *   @param events_out  Output stream to which DTMF events are to be written.
  *   @return 0  If reading of audio and writing of DTMF events is sucessful, EOF otherwise.
  */
-int output_event(int start, int end, char c, FILE* output) {
-	if (end - start < 250) {
-		// not long enough
-		return 0;
-	}
-	if (!c) {
-		return 0;
+int dtmf_detect(FILE *audio_in, FILE *events_out) {
+	// If the input is a file, map it rather than reading it, unless it is to be read
+	// by a thread of its own.
+	AUDIO_HEADER header;
+	AUDIO_MAP map;
+	int mapped = !queue_depth && audio_map_open(&map, audio_in) == 0;
+	if ((mapped ? audio_map_read_header(&map, &header) :
+	     audio_read_header(audio_in, &header)) == EOF) {
+		if (mapped) {
+			audio_map_close(&map);
+		}
+		return EOF;
 	}
-	fprintf(output, "%d\t%d\t%c\n", start, end, c);
-	// printf("%d\t%d\t%c\n", start, end, c);
-	return 0;
-}
 
-
-int dtmf_detect(FILE *audio_in, FILE *events_out) {
-	if (audio_read_header(audio_in, &empty_header) == EOF) {
+	// All of the detection state lives in the detectors, one for each channel.
+	DTMF_CHANNELS *channels = dtmf_channels_create(block_size, header.sample_rate,
+						       header.channels, events_out);
+	DTMF_DETECT_OPTIONS options = { 0 };
+	options.hop = hop_size;
+	options.refine = refine_size;
+	options.fixed = fixed_point;
+	options.tones = tone_spec;
+	if (!channels || dtmf_channels_configure(channels, &options, header.encoding) == EOF) {
+		if (channels) {
+			dtmf_channels_destroy(channels);
+		}
+		if (mapped) {
+			audio_map_close(&map);
+		}
 		return EOF;
 	}
-	int starting_block = 0;
-	int current_block = 0;
-	char previous_event = 0;
-
-	while (1) {
-    for (int i = 0; i < 8; i++) {
-    	int frequency = i_to_freq(i);
-    	int N = block_size;
-    	double k = frequency / 8000.0 * N;
-    	GOERTZEL_STATE* x = (i + goertzel_state);
-    	goertzel_init(x, N, k);
-    }
-
-    for (int i = 0; i < block_size - 1; i++) {
-    	// printf("%d\n", i);
-    	int16_t dtmf;
-    	int result = audio_read_sample(audio_in, &dtmf);
-    	if (result == EOF) {
-    		break;
-    	}
-    	current_block += 1;
-    	for (int j = 0; j < 8; j++) {
-    		GOERTZEL_STATE* x = (j + goertzel_state);
-    		goertzel_step(x, 1.0 * dtmf / INT16_MAX);
-    	}
-    }
-    int16_t dtmf;
-    int result = audio_read_sample(audio_in, &dtmf);
-    if (result == EOF) {
-    	break;
-    }
-    current_block += 1;
-    for (int j = 0; j < 8; j++) {
-    	GOERTZEL_STATE* x = (j + goertzel_state);
-    	double strength = goertzel_strength(x, 1.0 * dtmf / INT16_MAX);
-    	// printf("%d\n", current_block);
-    	// printf("%lf\n", strength);
-    	*(j + goertzel_strengths) = strength;
-    }
-
-    int row = 0;
-    int col = 4;
-
-    for (int j = 0; j < 8; j++) {
-	    double value = *(j + goertzel_strengths);
-    	if (j > 3) {
-    		if (value > *(col + goertzel_strengths)) {
-    			col = j;
-    		}
-    	} else {
-    		if (value > *(row + goertzel_strengths)) {
-    			row = j;
-    		}
-    	}
-    }
-
-    double row_value = *(row + goertzel_strengths);
-    double col_value = *(col + goertzel_strengths);
-
-    int is_valid = 1;
-
-    if (row_value + col_value >= .01) {
-    	double ratio = row_value / col_value;
-    	double four_db = FOUR_DB;
-    	if (ratio >= 1/four_db && ratio <= four_db) {
-    		double six_db = SIX_DB;
-    		for (int i = 0; i < 4; i++) {
-    			if (i == row) {
-    				continue;
-    			} else {
-    				double value = *(i + goertzel_strengths);
-    				double new_ratio = row_value / value;
-    				if (new_ratio < six_db) {
-    					is_valid = 0;
-    					break;
-    				}
-    			}
-    		}
-
-    		for (int i = 4; i < 8; i++) {
-    			if (i == col) {
-    				continue;
-    			} else {
-    				double value = *(i + goertzel_strengths);
-    				double new_ratio = col_value / value;
-    				if (new_ratio < six_db) {
-    					is_valid = 0;
-    					break;
-    				}
-    			}
-    		}
-    	} else {
-    		is_valid = 0;
-    	}
-    } else {
-    	is_valid = 0;
-   	}
-
-	if (is_valid) {
-		// THIS IS TRUE ONLY IF WE HAVE A VALID EVENT
-		char event = row_col_to_char(row, col - 4);
-		if (event == previous_event || previous_event == 0) {
-			previous_event = event;
-		} else {
-			output_event(starting_block, current_block - block_size, previous_event, events_out);
-			starting_block = current_block - block_size;
-			previous_event = event;
+	DTMF_TRACE *trace = NULL;
+	if (trace_file) {
+		if (!(trace = dtmf_trace_open(trace_file, block_size))) {
+			dtmf_channels_destroy(channels);
+			if (mapped) {
+				audio_map_close(&map);
+			}
+			return EOF;
 		}
+		dtmf_channels_set_trace(channels, trace);
+	}
+	int ret;
+	if (mapped) {
+		ret = dtmf_channels_run_mapped(channels, &map);
+		audio_map_close(&map);
+	} else if (queue_depth) {
+		AUDIO_PIPE *pipe = audio_pipe_open(audio_in, header.channels *
+						   audio_encoding_bytes(header.encoding), queue_depth);
+		if (!pipe) {
+			if (trace) {
+				dtmf_trace_close(trace);
+			}
+			dtmf_channels_destroy(channels);
+			return EOF;
+		}
+		ret = dtmf_channels_run_pipe(channels, pipe);
+		audio_pipe_close(pipe, stderr);
 	} else {
-		// printf("Current block: %d\n", current_block);
-		output_event(starting_block, current_block - block_size, previous_event, events_out);
-		starting_block = current_block;
-		previous_event = 0;
+		ret = dtmf_channels_run(channels, audio_in);
+	}
+
+	DTMF_DETECTOR *detector = *channels->detectors;
+	debug("Skipped %u of %u blocks as silent", detector->blocks_skipped, detector->blocks);
+
+	// Leave the strengths for the last block (of the first channel) where they
+	// have always been.
+	double *strengths = dtmf_detector_strengths(detector);
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		*(goertzel_strengths + i) = *(strengths + i);
+	}
+	dtmf_channels_destroy(channels);
+	if (trace && dtmf_trace_close(trace) == EOF) {
+		fprintf(stderr, "%s: error writing trace\n", trace_file);
+		ret = EOF;
 	}
-	} // ending the while loop
-	output_event(starting_block, current_block, previous_event, events_out);
-    return 0;
+	return ret;
 }
 
 int check_str_equal(char* str1, char* str2) {
@@ -429,6 +294,14 @@ int check_str_equal(char* str1, char* str2) {
 	}
 }
 
+int check_str_same(char* str1, char* str2) {
+	while (*str1 && *str1 == *str2) {
+		str1 += 1;
+		str2 += 1;
+	}
+	return *str1 == *str2;
+}
+
 int convert_str_to_int(char* str_num) {
 	int num = 0;
 	int is_negative = 0;
@@ -509,10 +382,13 @@ int validargs(int argc, char **argv)
 		int t_command_used = 0;
 		int n_command_used = 0;
 		int l_command_used = 0;
+		int j_command_used = 0;
+
+		num_jobs = 1;
 
-		int t_command_value;
-		char* n_command_value;
-		int l_command_value;
+		int t_command_value = 0;
+		char* n_command_value = 0;
+		int l_command_value = 0;
 
 		while (argc > 2) {
 			char* command = *(argv+1);
@@ -564,6 +440,19 @@ int validargs(int argc, char **argv)
 					return -1;
 				}
 				continue;
+			} else if (check_str_same(command, "-j")) {
+				if (j_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				j_command_used = 1;
+				argv += 2;
+				argc -= 2;
+				int jobs = convert_str_to_int(argument);
+				if (jobs < 1 || jobs > MAX_JOBS) {
+					return -1;
+				}
+				num_jobs = jobs;
+				continue;
 			} else {
 				return -1;
 			}
@@ -595,32 +484,128 @@ int validargs(int argc, char **argv)
 		argv += 1;
 		argc -= 1;
 
-		// if (argc > 2) {//why??
-		// 	return -1;
-		// }
-
-		if (argc == 1) {
-			block_size = 100;
-			return 0;
-		}
-		if(argc!=3){
-			return -1; //for it to have the -b option, must be 4 args
-		}
-
-		char* command = *(argv+1);
-		char* argument = *(argv+2);
+		int b_command_used = 0;
+		int s_command_used = 0;
+		int r_command_used = 0;
+		int j_command_used = 0;
+		int batch_command_used = 0;
+		int tones_command_used = 0;
+		int queue_command_used = 0;
+		int trace_command_used = 0;
+		int fixed_command_used = 0;
+
+		block_size = 100;
+		hop_size = 0;
+		refine_size = 0;
+		fixed_point = 0;
+		num_jobs = 1;
+		batch_file = 0;
+		tones_file = 0;
+		queue_depth = 0;
+		trace_file = 0;
+
+		while (argc > 1) {
+			char* command = *(argv+1);
+			if (check_str_same(command, "--fixed")) {
+				// The only option for -d without an argument
+				if (fixed_command_used) {
+					return -1;
+				}
+				fixed_command_used = 1;
+				fixed_point = 1;
+				argv += 1;
+				argc -= 1;
+				continue;
+			}
+			if (argc < 3) {
+				// Every other option for -d takes an argument
+				return -1;
+			}
+			char* argument = *(argv+2);
+			argv += 2;
+			argc -= 2;
 
-		if (check_str_equal(command, "-b")) {
-			if (is_valid_str_to_int(argument)) {
+			if (check_str_same(command, "-b")) {
+				if (b_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				b_command_used = 1;
 				int size = convert_str_to_int(argument);
 				if (size < 10 || size > 1000) {
 					return -1;
 				}
 				block_size = size;
+			} else if (check_str_same(command, "-s")) {
+				if (s_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				s_command_used = 1;
+				int hop = convert_str_to_int(argument);
+				if (hop < 1 || hop > 1000) {
+					return -1;
+				}
+				hop_size = hop;
+			} else if (check_str_same(command, "-r")) {
+				if (r_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				r_command_used = 1;
+				int fine = convert_str_to_int(argument);
+				if (fine < DTMF_MIN_FINE_SIZE || fine > 1000) {
+					return -1;
+				}
+				refine_size = fine;
+			} else if (check_str_same(command, "-j")) {
+				if (j_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				j_command_used = 1;
+				int jobs = convert_str_to_int(argument);
+				if (jobs < 1 || jobs > MAX_JOBS) {
+					return -1;
+				}
+				num_jobs = jobs;
+			} else if (check_str_same(command, "--batch")) {
+				if (batch_command_used) {
+					return -1;
+				}
+				batch_command_used = 1;
+				batch_file = argument;
+			} else if (check_str_same(command, "--tones")) {
+				if (tones_command_used) {
+					return -1;
+				}
+				tones_command_used = 1;
+				tones_file = argument;
+			} else if (check_str_same(command, "--queue")) {
+				if (queue_command_used || !is_valid_str_to_int(argument)) {
+					return -1;
+				}
+				queue_command_used = 1;
+				int depth = convert_str_to_int(argument);
+				if (depth < AUDIO_PIPE_MIN_DEPTH || depth > AUDIO_PIPE_MAX_DEPTH) {
+					return -1;
+				}
+				queue_depth = depth;
+			} else if (check_str_same(command, "--trace")) {
+				if (trace_command_used) {
+					return -1;
+				}
+				trace_command_used = 1;
+				trace_file = argument;
 			} else {
 				return -1;
 			}
-		} else {
+		}
+
+		// The hop defaults to the block size, and cannot exceed it.
+		if (!s_command_used) {
+			hop_size = block_size;
+		} else if (hop_size > block_size) {
+			return -1;
+		}
+		// Refining only makes sense with blocks smaller than the coarse ones.
+		if (refine_size >= block_size) {
 			return -1;
 		}
 
@@ -0,0 +1,232 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "audio.h"
+#include "debug.h"
+#include "dtmf_batch.h"
+#include "dtmf_channels.h"
+
+/*
+ * One audio file in a batch.
+ */
+typedef struct batch_job {
+	char *path;     // Name of the audio file.
+	char *text;     // Events detected in the file, once it has been analyzed.
+	size_t len;     // Length of the event text.
+	int status;     // 0 if the file was analyzed successfully, otherwise EOF.
+	int done;       // Nonzero once the file has been analyzed.
+} BATCH_JOB;
+
+/*
+ * State shared by the worker threads of a batch.  Everything except the array
+ * of paths is protected by the mutex.
+ */
+typedef struct batch {
+	BATCH_JOB *jobs;
+	int njobs;
+	int next_job;      // Index of the next file to be handed to a worker.
+	int next_output;   // Index of the next file whose events are to be written.
+	uint32_t block_size;
+	DTMF_DETECT_OPTIONS *options;
+	FILE *out;
+	int status;
+	pthread_mutex_t mutex;
+} BATCH;
+
+/*
+ * Read the names of the audio files from the list file, ignoring empty lines.
+ */
+static int batch_read_list(BATCH *bp, char *list_file) {
+	FILE *list = fopen(list_file, "r");
+	if (!list) {
+		fprintf(stderr, "%s: cannot open list file\n", list_file);
+		return EOF;
+	}
+	int capacity = 0;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	while ((len = getline(&line, &size, list)) != -1) {
+		while (len > 0 && (*(line + len - 1) == '\n' || *(line + len - 1) == '\r')) {
+			len -= 1;
+		}
+		if (len == 0) {
+			continue;
+		}
+		*(line + len) = '\0';
+		if (bp->njobs == capacity) {
+			capacity = capacity ? 2 * capacity : 64;
+			BATCH_JOB *jobs = realloc(bp->jobs, capacity * sizeof(BATCH_JOB));
+			if (!jobs) {
+				free(line);
+				fclose(list);
+				return EOF;
+			}
+			bp->jobs = jobs;
+		}
+		BATCH_JOB *jp = bp->jobs + bp->njobs;
+		jp->path = line;
+		jp->text = NULL;
+		jp->len = 0;
+		jp->status = 0;
+		jp->done = 0;
+		bp->njobs += 1;
+		line = NULL;
+		size = 0;
+	}
+	free(line);
+	fclose(list);
+	return 0;
+}
+
+/*
+ * Analyze one audio file, collecting its events in memory.  The detectors are
+ * replaced if the file has a different sample rate or number of channels from
+ * the previous one.
+ */
+static int batch_analyze(BATCH *bp, BATCH_JOB *jp, DTMF_CHANNELS **cpp) {
+	FILE *in = fopen(jp->path, "r");
+	if (!in) {
+		fprintf(stderr, "%s: cannot open audio file\n", jp->path);
+		return EOF;
+	}
+	AUDIO_HEADER header;
+	AUDIO_MAP map;
+	int mapped = audio_map_open(&map, in) == 0;
+	int ret = (mapped ? audio_map_read_header(&map, &header) :
+		   audio_read_header(in, &header));
+	if (ret == EOF) {
+		fprintf(stderr, "%s: invalid audio header\n", jp->path);
+	}
+	if (ret == 0 && *cpp && ((*cpp)->rate != header.sample_rate ||
+				 (*cpp)->nchannels != header.channels)) {
+		dtmf_channels_destroy(*cpp);
+		*cpp = NULL;
+	}
+	if (ret == 0 && !*cpp) {
+		*cpp = dtmf_channels_create(bp->block_size, header.sample_rate, header.channels, NULL);
+		if (!*cpp) {
+			ret = EOF;
+		}
+	}
+	if (ret == 0 && dtmf_channels_configure(*cpp, bp->options, header.encoding) == EOF) {
+		ret = EOF;
+	}
+	FILE *out = NULL;
+	if (ret == 0 && !(out = open_memstream(&jp->text, &jp->len))) {
+		ret = EOF;
+	}
+	if (ret == 0 && dtmf_channels_reset(*cpp, out, jp->path) == EOF) {
+		fclose(out);
+		ret = EOF;
+	}
+	if (ret == 0) {
+		ret = mapped ? dtmf_channels_run_mapped(*cpp, &map) : dtmf_channels_run(*cpp, in);
+		if (fclose(out) == EOF) {
+			ret = EOF;
+		}
+	}
+	if (mapped) {
+		audio_map_close(&map);
+	}
+	fclose(in);
+	return ret;
+}
+
+/*
+ * Write the events of all files that have been analyzed and that follow,
+ * without a gap, the files whose events have already been written.
+ * Must be called with the mutex held.
+ */
+static void batch_output(BATCH *bp) {
+	while (bp->next_output < bp->njobs && (bp->jobs + bp->next_output)->done) {
+		BATCH_JOB *jp = bp->jobs + bp->next_output;
+		if (jp->status == EOF) {
+			bp->status = EOF;
+		}
+		if (jp->len > 0 && fwrite(jp->text, 1, jp->len, bp->out) != jp->len) {
+			bp->status = EOF;
+		}
+		free(jp->text);
+		jp->text = NULL;
+		bp->next_output += 1;
+	}
+}
+
+static void *batch_worker(void *arg) {
+	BATCH *bp = arg;
+	DTMF_CHANNELS *cp = NULL;
+	while (1) {
+		pthread_mutex_lock(&bp->mutex);
+		if (bp->next_job == bp->njobs) {
+			pthread_mutex_unlock(&bp->mutex);
+			break;
+		}
+		BATCH_JOB *jp = bp->jobs + bp->next_job;
+		bp->next_job += 1;
+		pthread_mutex_unlock(&bp->mutex);
+
+		int status = batch_analyze(bp, jp, &cp);
+
+		pthread_mutex_lock(&bp->mutex);
+		jp->status = status;
+		jp->done = 1;
+		batch_output(bp);
+		pthread_mutex_unlock(&bp->mutex);
+	}
+	if (cp) {
+		dtmf_channels_destroy(cp);
+	}
+	return NULL;
+}
+
+int dtmf_detect_batch(char *list_file, FILE *events_out, int jobs, uint32_t block_size,
+		      DTMF_DETECT_OPTIONS *options) {
+	BATCH batch;
+	batch.jobs = NULL;
+	batch.njobs = 0;
+	batch.next_job = 0;
+	batch.next_output = 0;
+	batch.block_size = block_size;
+	batch.options = options;
+	batch.out = events_out;
+	batch.status = 0;
+	pthread_mutex_init(&batch.mutex, NULL);
+
+	if (batch_read_list(&batch, list_file) == EOF) {
+		batch.status = EOF;
+	} else {
+		if (jobs > batch.njobs) {
+			jobs = batch.njobs > 0 ? batch.njobs : 1;
+		}
+		pthread_t *threads = malloc(jobs * sizeof(pthread_t));
+		int started = 0;
+		if (threads) {
+			while (started < jobs &&
+			       pthread_create(threads + started, NULL, batch_worker, &batch) == 0) {
+				started += 1;
+			}
+		}
+		if (started == 0) {
+			// No threads could be started, so do all the work here.
+			batch_worker(&batch);
+		}
+		for (int i = 0; i < started; i++) {
+			pthread_join(*(threads + i), NULL);
+		}
+		free(threads);
+		debug("Analyzed %d files using %d threads", batch.njobs, started);
+	}
+
+	for (int i = 0; i < batch.njobs; i++) {
+		free((batch.jobs + i)->path);
+	}
+	free(batch.jobs);
+	pthread_mutex_destroy(&batch.mutex);
+	if (fflush(events_out) == EOF) {
+		batch.status = EOF;
+	}
+	return batch.status;
+}
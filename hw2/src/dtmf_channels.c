@@ -0,0 +1,198 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "audio_bulk.h"
+#include "debug.h"
+#include "dtmf_channels.h"
+
+/*
+ * Number of frames taken at a time.
+ */
+#define CHANNEL_CHUNK AUDIO_BULK_CHUNK
+
+DTMF_CHANNELS *dtmf_channels_create(uint32_t block_size, uint32_t rate, uint32_t nchannels,
+				    FILE *events_out) {
+	if (nchannels < 1 || nchannels > AUDIO_MAX_CHANNELS) {
+		return NULL;
+	}
+	DTMF_CHANNELS *cp = calloc(1, sizeof(DTMF_CHANNELS));
+	if (!cp) {
+		return NULL;
+	}
+	cp->nchannels = nchannels;
+	cp->encoding = PCM16_ENCODING;
+	cp->rate = rate;
+	cp->detectors = calloc(nchannels, sizeof(DTMF_DETECTOR *));
+	cp->tags = calloc(nchannels, sizeof(char *));
+	if (nchannels > 1) {
+		cp->frames = malloc(CHANNEL_CHUNK * nchannels * sizeof(int16_t));
+		cp->split = malloc(CHANNEL_CHUNK * sizeof(int16_t));
+	}
+	if (!cp->detectors || !cp->tags || (nchannels > 1 && (!cp->frames || !cp->split))) {
+		dtmf_channels_destroy(cp);
+		return NULL;
+	}
+	for (uint32_t c = 0; c < nchannels; c++) {
+		*(cp->detectors + c) = dtmf_detector_create(block_size, rate, events_out);
+		if (!*(cp->detectors + c)) {
+			dtmf_channels_destroy(cp);
+			return NULL;
+		}
+	}
+	if (dtmf_channels_reset(cp, events_out, NULL) == EOF) {
+		dtmf_channels_destroy(cp);
+		return NULL;
+	}
+	return cp;
+}
+
+int dtmf_channels_configure(DTMF_CHANNELS *cp, DTMF_DETECT_OPTIONS *options, uint32_t encoding) {
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		DTMF_DETECTOR *dp = *(cp->detectors + c);
+		if ((options->hop > 0 && dtmf_detector_set_hop(dp, options->hop) == EOF) ||
+		    dtmf_detector_set_refine(dp, options->refine) == EOF ||
+		    dtmf_detector_set_fixed(dp, options->fixed) == EOF ||
+		    dtmf_detector_set_encoding(dp, encoding) == EOF ||
+		    dtmf_detector_set_tones(dp, options->tones) == EOF) {
+			return EOF;
+		}
+	}
+	cp->encoding = encoding;
+	return 0;
+}
+
+void dtmf_channels_set_trace(DTMF_CHANNELS *cp, DTMF_TRACE *tp) {
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		dtmf_detector_set_trace(*(cp->detectors + c), tp, c);
+	}
+}
+
+int dtmf_channels_reset(DTMF_CHANNELS *cp, FILE *events_out, char *tag) {
+	size_t len = 0;
+	while (tag && *(tag + len)) {
+		len++;
+	}
+	int ret = 0;
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		free(*(cp->tags + c));
+		*(cp->tags + c) = NULL;
+		if (cp->nchannels > 1) {
+			// Room for the tag, a tab and the channel number.
+			size_t size = len + 16;
+			char *t = malloc(size);
+			if (t && tag) {
+				snprintf(t, size, "%s\t%u", tag, c);
+			} else if (t) {
+				snprintf(t, size, "%u", c);
+			} else {
+				ret = EOF;
+			}
+			*(cp->tags + c) = t;
+		}
+		dtmf_detector_reset(*(cp->detectors + c), events_out,
+				    cp->nchannels > 1 ? *(cp->tags + c) : tag);
+	}
+	return ret;
+}
+
+/*
+ * Give the samples of each channel in a chunk of frames to its detector.
+ */
+static int channels_feed(DTMF_CHANNELS *cp, size_t nframes) {
+	int ret = 0;
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		int16_t *src = cp->frames + c;
+		for (size_t i = 0; i < nframes; i++) {
+			*(cp->split + i) = *src;
+			src += cp->nchannels;
+		}
+		if (dtmf_detector_feed(*(cp->detectors + c), cp->split, nframes) == EOF) {
+			ret = EOF;
+		}
+	}
+	return ret;
+}
+
+static int channels_finish(DTMF_CHANNELS *cp, int ret) {
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		if (dtmf_detector_finish(*(cp->detectors + c)) == EOF) {
+			ret = EOF;
+		}
+	}
+	return ret;
+}
+
+int dtmf_channels_run(DTMF_CHANNELS *cp, FILE *audio_in) {
+	if (cp->nchannels == 1) {
+		return dtmf_detector_run(*cp->detectors, audio_in);
+	}
+	int ret = 0;
+	size_t n;
+	while ((n = audio_read_encoded(audio_in, cp->encoding, cp->frames,
+				       CHANNEL_CHUNK * cp->nchannels) / cp->nchannels) > 0) {
+		if (channels_feed(cp, n) == EOF) {
+			ret = EOF;
+		}
+	}
+	return channels_finish(cp, ret);
+}
+
+/*
+ * Give frames held in memory, in the encoding and byte order of the file, to the
+ * detectors, a chunk at a time.
+ */
+static int channels_feed_encoded(DTMF_CHANNELS *cp, uint8_t *data, size_t nframes) {
+	if (cp->nchannels == 1) {
+		return dtmf_detector_feed_mapped(*cp->detectors, data, nframes);
+	}
+	int ret = 0;
+	size_t frame_bytes = cp->nchannels * audio_encoding_bytes(cp->encoding);
+	while (nframes > 0) {
+		size_t n = nframes < CHANNEL_CHUNK ? nframes : CHANNEL_CHUNK;
+		audio_decode_encoded(data, cp->encoding, cp->frames, n * cp->nchannels);
+		if (channels_feed(cp, n) == EOF) {
+			ret = EOF;
+		}
+		data += n * frame_bytes;
+		nframes -= n;
+	}
+	return ret;
+}
+
+int dtmf_channels_run_mapped(DTMF_CHANNELS *cp, AUDIO_MAP *mp) {
+	if (cp->nchannels == 1) {
+		return dtmf_detector_run_mapped(*cp->detectors, mp);
+	}
+	int ret = channels_feed_encoded(cp, mp->data, mp->nsamples / cp->nchannels);
+	return channels_finish(cp, ret);
+}
+
+int dtmf_channels_run_pipe(DTMF_CHANNELS *cp, AUDIO_PIPE *pp) {
+	int ret = 0;
+	size_t frame_bytes = cp->nchannels * audio_encoding_bytes(cp->encoding);
+	uint8_t *data;
+	size_t len;
+	while ((len = audio_pipe_next(pp, &data)) > 0) {
+		if (channels_feed_encoded(cp, data, len / frame_bytes) == EOF) {
+			ret = EOF;
+		}
+	}
+	return channels_finish(cp, ret);
+}
+
+void dtmf_channels_destroy(DTMF_CHANNELS *cp) {
+	for (uint32_t c = 0; c < cp->nchannels; c++) {
+		if (cp->detectors && *(cp->detectors + c)) {
+			dtmf_detector_destroy(*(cp->detectors + c));
+		}
+		if (cp->tags) {
+			free(*(cp->tags + c));
+		}
+	}
+	free(cp->detectors);
+	free(cp->tags);
+	free(cp->frames);
+	free(cp->split);
+	free(cp);
+}
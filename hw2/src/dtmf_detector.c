@@ -0,0 +1,710 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "const.h"
+#include "audio_bulk.h"
+#include "audio_map.h"
+#include "debug.h"
+#include "dtmf_detector.h"
+#include "goertzel_fixed.h"
+
+DTMF_DETECTOR *dtmf_detector_create(uint32_t block_size, uint32_t rate, FILE *events_out) {
+	// Higher sample rates are converted, and analyzed as if they were the usual one.
+	int decimate = rate != AUDIO_FRAME_RATE && audio_decimator_supported(rate);
+	DTMF_PLAN *plan = dtmf_plan_get(block_size, decimate ? AUDIO_FRAME_RATE : rate, dtmf_freqs);
+	if (!plan) {
+		return NULL;
+	}
+	DTMF_DETECTOR *dp = malloc(sizeof(DTMF_DETECTOR));
+	if (!dp) {
+		return NULL;
+	}
+	dp->block = malloc(block_size * sizeof(double));
+	dp->skipped = malloc(block_size * sizeof(double));
+	dp->decimator = decimate ? audio_decimator_create(rate) : NULL;
+	if (!dp->block || !dp->skipped || (decimate && !dp->decimator)) {
+		free(dp->block);
+		free(dp->skipped);
+		audio_decimator_destroy(dp->decimator);
+		free(dp);
+		return NULL;
+	}
+	dp->rate = rate;
+	dp->raw = NULL;
+	dp->raw_skipped = NULL;
+	dp->plan = plan;
+	dp->block_size = block_size;
+	dp->hop = block_size;
+	dp->gate = 1;
+	dp->fixed = 0;
+	dp->encoding = PCM16_ENCODING;
+	dp->tones = NULL;
+	dp->refine = 0;
+	dp->fine_plan = NULL;
+	dp->history = NULL;
+	dp->trace = NULL;
+	dp->channel = 0;
+	dtmf_detector_set_listener(dp, NULL);
+	dtmf_detector_reset(dp, events_out, NULL);
+	return dp;
+}
+
+void dtmf_detector_reset(DTMF_DETECTOR *dp, FILE *events_out, char *tag) {
+	goertzel_bank_init(&dp->bank, dp->plan);
+	dp->fill = 0;
+	dp->samples = 0;
+	dp->samples_in = 0;
+	if (dp->decimator) {
+		audio_decimator_reset(dp->decimator);
+	}
+	if (dp->tones) {
+		tone_bank_reset(dp->tones);
+	}
+	for (uint32_t i = 0; dp->history && i < 2 * dp->block_size; i++) {
+		*(dp->history + i) = 0;
+	}
+	if (dp->hop < dp->block_size) {
+		// The window starts out full of silence.
+		goertzel_slide_init(&dp->slide, dp->plan);
+		for (uint32_t i = 0; i < dp->block_size; i++) {
+			*(dp->block + i) = 0;
+		}
+	}
+	dp->next_window = dp->block_size;
+	dp->slid = 0;
+	dp->event_start = 0;
+	dp->event_symbol = 0;
+	dp->event_blocks = 0;
+	dp->event_announced = 0;
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		*(dp->strengths + i) = 0;
+	}
+	dp->strengths_stale = 0;
+	dp->blocks = 0;
+	dp->blocks_skipped = 0;
+	dp->out = events_out;
+	dp->tag = tag;
+}
+
+int dtmf_detector_set_hop(DTMF_DETECTOR *dp, uint32_t hop) {
+	if (hop < 1 || hop > dp->block_size) {
+		return EOF;
+	}
+	dp->hop = hop;
+	dtmf_detector_reset(dp, dp->out, dp->tag);
+	return 0;
+}
+
+int dtmf_detector_set_fixed(DTMF_DETECTOR *dp, int fixed) {
+	if (fixed && !dp->raw) {
+		dp->raw = malloc(dp->block_size * sizeof(int16_t));
+		dp->raw_skipped = malloc(dp->block_size * sizeof(int16_t));
+		if (!dp->raw || !dp->raw_skipped) {
+			free(dp->raw);
+			free(dp->raw_skipped);
+			dp->raw = NULL;
+			dp->raw_skipped = NULL;
+			return EOF;
+		}
+	}
+	dp->fixed = fixed;
+	return 0;
+}
+
+int dtmf_detector_set_encoding(DTMF_DETECTOR *dp, uint32_t encoding) {
+	if (!audio_encoding_bytes(encoding)) {
+		return EOF;
+	}
+	dp->encoding = encoding;
+	return 0;
+}
+
+int dtmf_detector_set_refine(DTMF_DETECTOR *dp, uint32_t fine_size) {
+	if (fine_size >= dp->block_size || (fine_size && fine_size < DTMF_MIN_FINE_SIZE)) {
+		return EOF;
+	}
+	free(dp->history);
+	dp->history = NULL;
+	dp->refine = 0;
+	if (fine_size == 0) {
+		return 0;
+	}
+	dp->fine_plan = dtmf_plan_get(fine_size, dp->plan->rate, dtmf_freqs);
+	dp->history = calloc(2 * dp->block_size, sizeof(double));
+	if (!dp->fine_plan || !dp->history) {
+		free(dp->history);
+		dp->history = NULL;
+		return EOF;
+	}
+	goertzel_bank_init(&dp->fine_bank, dp->fine_plan);
+	dp->refine = fine_size;
+	return 0;
+}
+
+void dtmf_detector_set_trace(DTMF_DETECTOR *dp, DTMF_TRACE *tp, uint32_t channel) {
+	dp->trace = tp;
+	dp->channel = channel;
+}
+
+/*
+ * Write an event detected by the tone bank, in the same way as a DTMF event.
+ */
+static int detector_tone(void *arg, char *name, uint32_t start, uint32_t end);
+
+int dtmf_detector_set_tones(DTMF_DETECTOR *dp, TONE_SPEC *sp) {
+	if (dp->tones) {
+		tone_bank_destroy(dp->tones);
+		dp->tones = NULL;
+	}
+	if (sp && !(dp->tones = tone_bank_create(sp, dp->plan->rate, detector_tone, dp))) {
+		return EOF;
+	}
+	return 0;
+}
+
+void dtmf_detector_set_listener(DTMF_DETECTOR *dp, DTMF_LISTENER *lp) {
+	if (lp) {
+		dp->listener = *lp;
+	} else {
+		dp->listener.tone_start = NULL;
+		dp->listener.tone_end = NULL;
+		dp->listener.arg = NULL;
+		dp->listener.confirm_blocks = 1;
+	}
+}
+
+void dtmf_detector_destroy(DTMF_DETECTOR *dp) {
+	free(dp->block);
+	free(dp->skipped);
+	free(dp->raw);
+	free(dp->raw_skipped);
+	audio_decimator_destroy(dp->decimator);
+	if (dp->tones) {
+		tone_bank_destroy(dp->tones);
+	}
+	free(dp->history);
+	free(dp);
+}
+
+char dtmf_block_classify(double *strengths, int *rowp, int *colp, int *reasonp) {
+	int row = 0;
+	int col = NUM_DTMF_ROW_FREQS;
+
+	for (int j = 0; j < NUM_DTMF_FREQS; j++) {
+		double value = *(strengths + j);
+		if (j >= NUM_DTMF_ROW_FREQS) {
+			if (value > *(strengths + col)) {
+				col = j;
+			}
+		} else {
+			if (value > *(strengths + row)) {
+				row = j;
+			}
+		}
+	}
+
+	double row_value = *(strengths + row);
+	double col_value = *(strengths + col);
+	*rowp = row;
+	*colp = col;
+
+	if (!(row_value + col_value >= MINUS_20DB)) {
+		*reasonp = DTMF_BLOCK_WEAK;
+		return 0;
+	}
+	double ratio = row_value / col_value;
+	double four_db = FOUR_DB;
+	if (!(ratio >= 1 / four_db && ratio <= four_db)) {
+		*reasonp = DTMF_BLOCK_TWIST;
+		return 0;
+	}
+	double six_db = SIX_DB;
+	for (int i = 0; i < NUM_DTMF_ROW_FREQS; i++) {
+		if (i != row && row_value / *(strengths + i) < six_db) {
+			*reasonp = DTMF_BLOCK_ROW_MARGIN;
+			return 0;
+		}
+	}
+	for (int i = NUM_DTMF_ROW_FREQS; i < NUM_DTMF_FREQS; i++) {
+		if (i != col && col_value / *(strengths + i) < six_db) {
+			*reasonp = DTMF_BLOCK_COL_MARGIN;
+			return 0;
+		}
+	}
+	*reasonp = DTMF_BLOCK_ACCEPTED;
+	return *(*(dtmf_symbol_names + row) + col - NUM_DTMF_ROW_FREQS);
+}
+
+char dtmf_block_symbol(double *strengths) {
+	int row, col, reason;
+	return dtmf_block_classify(strengths, &row, &col, &reason);
+}
+
+static int energy_silent(double energy, uint32_t n) {
+	return DTMF_GATE_MARGIN * 4 * energy < MINUS_20DB * n;
+}
+
+int dtmf_block_silent(double *x, uint32_t n) {
+	return energy_silent(goertzel_bank_energy(x, n), n);
+}
+
+int dtmf_raw_block_silent(int16_t *x, uint32_t n) {
+	return energy_silent(goertzel_fixed_energy(x, n), n);
+}
+
+/*
+ * Index of the sample given to a detector that corresponds to a sample index at
+ * AUDIO_FRAME_RATE.
+ */
+static uint32_t detector_index(DTMF_DETECTOR *dp, uint32_t i) {
+	if (!dp->decimator) {
+		return i;
+	}
+	uint64_t index = (uint64_t)i * dp->decimator->M / dp->decimator->L;
+	return index < dp->samples_in ? index : dp->samples_in;
+}
+
+/*
+ * Report a completed event: to the listener, if the tone was announced, and to
+ * the output stream, if it is long enough.
+ */
+static int detector_emit(DTMF_DETECTOR *dp, uint32_t start, uint32_t end, char symbol) {
+	int long_enough = end - start >= DTMF_MIN_EVENT_SAMPLES;
+	start = detector_index(dp, start);
+	end = detector_index(dp, end);
+	if (symbol && dp->event_announced && dp->listener.tone_end) {
+		dp->listener.tone_end(dp->listener.arg, symbol, start, end);
+	}
+	dp->event_announced = 0;
+	if (!symbol || !dp->out || !long_enough) {
+		return 0;
+	}
+	if (dp->tag && fprintf(dp->out, "%s\t", dp->tag) < 0) {
+		return EOF;
+	}
+	if (fprintf(dp->out, "%u\t%u\t%c\n", start, end, symbol) < 0) {
+		return EOF;
+	}
+	return 0;
+}
+
+static int detector_tone(void *arg, char *name, uint32_t start, uint32_t end) {
+	DTMF_DETECTOR *dp = arg;
+	if (!dp->out) {
+		return 0;
+	}
+	if (dp->tag && fprintf(dp->out, "%s\t", dp->tag) < 0) {
+		return EOF;
+	}
+	if (fprintf(dp->out, "%u\t%u\t%s\n", detector_index(dp, start), detector_index(dp, end),
+		    name) < 0) {
+		return EOF;
+	}
+	return 0;
+}
+
+/*
+ * Determine the symbol in the block (or window) just analyzed, or skipped as silent,
+ * and add its analysis to the trace, if there is one.
+ */
+static char detector_verdict(DTMF_DETECTOR *dp, int silent) {
+	if (!dp->trace) {
+		return silent ? 0 : dtmf_block_symbol(dp->strengths);
+	}
+	DTMF_TRACE_BLOCK b;
+	uint32_t N = dp->block_size;
+	b.index = detector_index(dp, dp->samples >= N ? dp->samples - N : 0);
+	b.channel = dp->channel;
+	if (dp->fixed && dp->hop == N) {
+		b.energy = goertzel_fixed_energy(silent ? dp->raw_skipped : dp->raw, N);
+	} else {
+		b.energy = goertzel_bank_energy(silent ? dp->skipped : dp->block, N);
+	}
+	// The strengths of a silent block are computed only for the trace.
+	double *strengths = dtmf_detector_strengths(dp);
+	int row, col, reason;
+	char symbol = dtmf_block_classify(strengths, &row, &col, &reason);
+	if (silent) {
+		symbol = 0;
+		reason = DTMF_BLOCK_SILENT;
+	}
+	b.row = row;
+	b.col = col;
+	b.reason = reason;
+	b.symbol = symbol;
+	*b.unused = *(b.unused + 1) = 0;
+	for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+		*(b.strengths + f) = *(strengths + f);
+	}
+	dtmf_trace_block(dp->trace, &b);
+	return symbol;
+}
+
+/*
+ * Keep the samples of the block that has just been collected, after those of the
+ * block before it, for refining boundaries.
+ */
+static void detector_record(DTMF_DETECTOR *dp) {
+	uint32_t N = dp->block_size;
+	for (uint32_t i = 0; i < N; i++) {
+		*(dp->history + i) = *(dp->history + N + i);
+	}
+	if (dp->fixed) {
+		audio_normalize_samples(dp->raw, dp->history + N, N);
+	} else {
+		for (uint32_t i = 0; i < N; i++) {
+			*(dp->history + N + i) = *(dp->block + i);
+		}
+	}
+}
+
+/*
+ * Refine a boundary found between the last two blocks, at index dp->samples - N,
+ * by analyzing their samples with fine blocks, one of which starts at the boundary.
+ *
+ *   @param symbol  The symbol of the event that starts or ends at the boundary.
+ *   @param at_end  Nonzero if the event ends at the boundary, 0 if it starts there.
+ *   @return  The refined boundary.
+ */
+static uint32_t detector_refine(DTMF_DETECTOR *dp, char symbol, int at_end) {
+	uint32_t N = dp->block_size, n = dp->refine;
+	uint32_t boundary = dp->samples - N;
+	int count = N / n;
+	double strengths[NUM_DTMF_FREQS];
+	// Fine block m covers boundary + m * n up to boundary + (m + 1) * n.
+	for (int k = 0; k < 2 * count; k++) {
+		int m = at_end ? count - 1 - k : k - count;
+		if ((int64_t)boundary + (int64_t)m * n < 0) {
+			continue;
+		}
+		goertzel_bank_block(&dp->fine_bank, dp->history + N + m * (int)n, strengths);
+		if (dtmf_block_symbol(strengths) == symbol) {
+			return boundary + (m + (at_end ? 1 : 0)) * (int)n;
+		}
+	}
+	return boundary;
+}
+
+/*
+ * Extend, end or start an event according to the symbol found in the window
+ * that ends at index dp->samples.  The window stands for the hop samples at its
+ * center, which for non-overlapping blocks is the whole block.
+ */
+static int detector_advance(DTMF_DETECTOR *dp, char symbol) {
+	uint32_t margin = (dp->block_size - dp->hop) / 2;
+	uint32_t segment_start = dp->samples - dp->block_size + margin;
+	uint32_t segment_end = segment_start + dp->hop;
+	int refine = dp->refine && dp->hop == dp->block_size;
+	uint32_t end = segment_start;
+	int ret = 0;
+
+	if (refine && dp->event_symbol && symbol != dp->event_symbol) {
+		end = detector_refine(dp, dp->event_symbol, 1);
+	}
+	if (symbol) {
+		if (symbol != dp->event_symbol && dp->event_symbol != 0) {
+			ret = detector_emit(dp, dp->event_start, end, dp->event_symbol);
+			dp->event_start = segment_start;
+		}
+		if (symbol != dp->event_symbol) {
+			if (refine) {
+				// The new event cannot start before the last one ended.
+				uint32_t start = detector_refine(dp, symbol, 0);
+				dp->event_start = start > end || !dp->event_symbol ? start : end;
+			}
+			dp->event_blocks = 0;
+		}
+		dp->event_symbol = symbol;
+		dp->event_blocks += 1;
+		if (!dp->event_announced && dp->event_blocks >= dp->listener.confirm_blocks) {
+			dp->event_announced = 1;
+			if (dp->listener.tone_start) {
+				dp->listener.tone_start(dp->listener.arg, symbol,
+							detector_index(dp, dp->event_start));
+			}
+		}
+	} else {
+		ret = detector_emit(dp, dp->event_start, end, dp->event_symbol);
+		dp->event_start = segment_end;
+		dp->event_symbol = 0;
+		dp->event_blocks = 0;
+	}
+	return ret;
+}
+
+/*
+ * Run the filters over the block that has just been collected, unless the gate
+ * finds it silent, in which case its samples are kept in case the strengths are
+ * asked for later, and the next block is collected in the other buffer.
+ *
+ *   @return  Nonzero if the block was skipped as silent.
+ */
+static int detector_analyze(DTMF_DETECTOR *dp) {
+	if (dp->fixed) {
+		if (dp->gate && dtmf_raw_block_silent(dp->raw, dp->block_size)) {
+			int16_t *x = dp->raw_skipped;
+			dp->raw_skipped = dp->raw;
+			dp->raw = x;
+			dp->strengths_stale = 1;
+			dp->blocks_skipped += 1;
+			return 1;
+		}
+		goertzel_fixed_block(dp->plan, dp->raw, dp->strengths);
+		dp->strengths_stale = 0;
+		return 0;
+	}
+	if (dp->gate && dtmf_block_silent(dp->block, dp->block_size)) {
+		double *x = dp->skipped;
+		dp->skipped = dp->block;
+		dp->block = x;
+		dp->strengths_stale = 1;
+		dp->blocks_skipped += 1;
+		return 1;
+	}
+	goertzel_bank_block(&dp->bank, dp->block, dp->strengths);
+	dp->strengths_stale = 0;
+	return 0;
+}
+
+/*
+ * Analyze the block that has just been collected.
+ */
+static int detector_block(DTMF_DETECTOR *dp) {
+	dp->blocks += 1;
+	if (dp->history) {
+		detector_record(dp);
+	}
+	return detector_advance(dp, detector_verdict(dp, detector_analyze(dp)));
+}
+
+char dtmf_detector_analyze(DTMF_DETECTOR *dp, int16_t *samples) {
+	if (dp->fixed) {
+		for (uint32_t i = 0; i < dp->block_size; i++) {
+			*(dp->raw + i) = *(samples + i);
+		}
+	} else {
+		audio_normalize_samples(samples, dp->block, dp->block_size);
+	}
+	dp->blocks += 1;
+	return detector_verdict(dp, detector_analyze(dp));
+}
+
+double *dtmf_detector_strengths(DTMF_DETECTOR *dp) {
+	if (dp->strengths_stale && dp->fixed) {
+		goertzel_fixed_block(dp->plan, dp->raw_skipped, dp->strengths);
+		dp->strengths_stale = 0;
+	} else if (dp->strengths_stale) {
+		goertzel_bank_block(&dp->bank, dp->skipped, dp->strengths);
+		dp->strengths_stale = 0;
+	}
+	return dp->strengths;
+}
+
+int dtmf_detector_replay(DTMF_DETECTOR *dp, char symbol, uint32_t nblocks) {
+	int ret = 0;
+	while (nblocks > 0) {
+		dp->samples += dp->block_size;
+		if (detector_advance(dp, symbol) == EOF) {
+			ret = EOF;
+		}
+		nblocks -= 1;
+	}
+	return ret;
+}
+
+/*
+ * Analyze the window that ends with the sample just given to a detector whose
+ * windows overlap.
+ */
+static int detector_window(DTMF_DETECTOR *dp) {
+	uint32_t N = dp->block_size;
+	if (dp->slid >= DTMF_SLIDE_RESYNC * N) {
+		// Recompute the outputs from the samples in the window, oldest first.
+		goertzel_slide_init(&dp->slide, dp->plan);
+		goertzel_slide_step(&dp->slide, dp->block + dp->fill, NULL, N - dp->fill);
+		goertzel_slide_step(&dp->slide, dp->block, NULL, dp->fill);
+		dp->slid = 0;
+	}
+	dp->blocks += 1;
+	goertzel_slide_strengths(&dp->slide, dp->strengths);
+	return detector_advance(dp, detector_verdict(dp, 0));
+}
+
+/*
+ * Give samples to a detector whose windows overlap.  The block buffer holds the
+ * samples of the current window, as a ring in which dp->fill is the position of
+ * the oldest sample.
+ */
+static int detector_feed_sliding(DTMF_DETECTOR *dp, int16_t *samples, size_t n) {
+	double x[AUDIO_BULK_CHUNK / 16];
+	int ret = 0;
+	while (n > 0) {
+		uint32_t count = dp->block_size - dp->fill;
+		if (count > dp->next_window - dp->samples) {
+			count = dp->next_window - dp->samples;
+		}
+		if (count > sizeof(x) / sizeof(double)) {
+			count = sizeof(x) / sizeof(double);
+		}
+		if (count > n) {
+			count = n;
+		}
+		audio_normalize_samples(samples, x, count);
+		goertzel_slide_step(&dp->slide, x, dp->block + dp->fill, count);
+		for (uint32_t i = 0; i < count; i++) {
+			*(dp->block + dp->fill + i) = *(x + i);
+		}
+		dp->fill += count;
+		if (dp->fill == dp->block_size) {
+			dp->fill = 0;
+		}
+		dp->samples += count;
+		dp->slid += count;
+		samples += count;
+		n -= count;
+		if (dp->samples == dp->next_window) {
+			if (detector_window(dp) == EOF) {
+				ret = EOF;
+			}
+			dp->next_window += dp->hop;
+		}
+	}
+	return ret;
+}
+
+/*
+ * Collect samples into blocks and analyze each block as it is completed.  The
+ * samples are given either in host byte order, or (if samples is NULL) in the
+ * encoding and byte order of the file, as they lie in a mapped file.
+ */
+static int detector_feed_blocks(DTMF_DETECTOR *dp, int16_t *samples, uint8_t *data, size_t n) {
+	int ret = 0;
+	while (n > 0) {
+		uint32_t count = dp->block_size - dp->fill;
+		if (count > n) {
+			count = n;
+		}
+		if (samples && dp->fixed) {
+			for (uint32_t i = 0; i < count; i++) {
+				*(dp->raw + dp->fill + i) = *(samples + i);
+			}
+			samples += count;
+		} else if (samples) {
+			audio_normalize_samples(samples, dp->block + dp->fill, count);
+			samples += count;
+		} else if (dp->fixed) {
+			audio_decode_encoded(data, dp->encoding, dp->raw + dp->fill, count);
+			data += count * audio_encoding_bytes(dp->encoding);
+		} else {
+			audio_normalize_encoded(data, dp->encoding, dp->block + dp->fill, count);
+			data += count * audio_encoding_bytes(dp->encoding);
+		}
+		dp->fill += count;
+		dp->samples += count;
+		n -= count;
+		if (dp->fill == dp->block_size) {
+			if (detector_block(dp) == EOF) {
+				ret = EOF;
+			}
+			dp->fill = 0;
+		}
+	}
+	return ret;
+}
+
+/*
+ * Give samples at AUDIO_FRAME_RATE to a detector.
+ */
+static int detector_feed_converted(DTMF_DETECTOR *dp, int16_t *samples, size_t n) {
+	int ret = 0;
+	if (dp->tones && tone_bank_feed(dp->tones, samples, n) == EOF) {
+		ret = EOF;
+	}
+	if ((dp->hop < dp->block_size ? detector_feed_sliding(dp, samples, n) :
+	     detector_feed_blocks(dp, samples, NULL, n)) == EOF) {
+		ret = EOF;
+	}
+	return ret;
+}
+
+int dtmf_detector_feed(DTMF_DETECTOR *dp, int16_t *samples, size_t n) {
+	if (!dp->decimator) {
+		return detector_feed_converted(dp, samples, n);
+	}
+	int16_t converted[DECIMATOR_CHUNK + 1];
+	int ret = 0;
+	while (n > 0) {
+		size_t count = n < DECIMATOR_CHUNK ? n : DECIMATOR_CHUNK;
+		size_t m = audio_decimator_run(dp->decimator, samples, count, converted);
+		dp->samples_in += count;
+		if (detector_feed_converted(dp, converted, m) == EOF) {
+			ret = EOF;
+		}
+		samples += count;
+		n -= count;
+	}
+	return ret;
+}
+
+int dtmf_detector_feed_mapped(DTMF_DETECTOR *dp, uint8_t *data, size_t n) {
+	if (dp->hop >= dp->block_size && !dp->decimator && !dp->tones) {
+		return detector_feed_blocks(dp, NULL, data, n);
+	}
+	// The sliding filters, the decimator and the tone bank take the samples in host
+	// byte order.
+	int16_t samples[AUDIO_BULK_CHUNK];
+	int ret = 0;
+	while (n > 0) {
+		size_t count = n < AUDIO_BULK_CHUNK ? n : AUDIO_BULK_CHUNK;
+		audio_decode_encoded(data, dp->encoding, samples, count);
+		if (dtmf_detector_feed(dp, samples, count) == EOF) {
+			ret = EOF;
+		}
+		data += count * audio_encoding_bytes(dp->encoding);
+		n -= count;
+	}
+	return ret;
+}
+
+int dtmf_detector_finish(DTMF_DETECTOR *dp) {
+	int ret = 0;
+	if (dp->decimator) {
+		// Convert the last samples, which the decimator has been holding back.
+		int16_t converted[DECIMATOR_CHUNK];
+		size_t m = audio_decimator_finish(dp->decimator, converted);
+		ret = detector_feed_converted(dp, converted, m);
+	}
+	if (dp->tones && tone_bank_finish(dp->tones) == EOF) {
+		ret = EOF;
+	}
+	if (detector_emit(dp, dp->event_start, dp->samples, dp->event_symbol) == EOF) {
+		ret = EOF;
+	}
+	dp->event_symbol = 0;
+	dp->event_blocks = 0;
+	return ret;
+}
+
+int dtmf_detector_run(DTMF_DETECTOR *dp, FILE *audio_in) {
+	int16_t samples[AUDIO_BULK_CHUNK];
+	int ret = 0;
+	size_t n;
+	while ((n = audio_read_encoded(audio_in, dp->encoding, samples, AUDIO_BULK_CHUNK)) > 0) {
+		if (dtmf_detector_feed(dp, samples, n) == EOF) {
+			ret = EOF;
+		}
+	}
+	if (dtmf_detector_finish(dp) == EOF) {
+		ret = EOF;
+	}
+	return ret;
+}
+
+int dtmf_detector_run_mapped(DTMF_DETECTOR *dp, AUDIO_MAP *mp) {
+	int ret = dtmf_detector_feed_mapped(dp, mp->data, mp->nsamples);
+	if (dtmf_detector_finish(dp) == EOF) {
+		ret = EOF;
+	}
+	return ret;
+}
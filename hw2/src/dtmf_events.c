@@ -0,0 +1,251 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "dtmf.h"
+#include "dtmf_events.h"
+#include "dtmf_synth.h"
+#include "debug.h"
+
+/*
+ * Next character of the script, or EOF at its end.
+ */
+static int next_char(DTMF_EVENT_READER *rp) {
+	if (rp->pos == rp->fill) {
+		rp->fill = fread(rp->text, 1, DTMF_EVENT_TEXT, rp->in);
+		rp->pos = 0;
+		if (rp->fill == 0) {
+			return EOF;
+		}
+	}
+	return (unsigned char)*(rp->text + rp->pos++);
+}
+
+/*
+ * Parse a sample index terminated by a tab.  An empty index is taken as 0.
+ */
+static int parse_index(DTMF_EVENT_READER *rp, uint32_t *indexp) {
+	uint64_t index = 0;
+	int c;
+	while ((c = next_char(rp)) != '\t') {
+		if (c < '0' || c > '9') {
+			return EOF;
+		}
+		index = index * 10 + (c - '0');
+		// Anything this large is beyond the end of the audio.
+		if (index > UINT32_MAX) {
+			return EOF;
+		}
+	}
+	*indexp = index;
+	return 0;
+}
+
+/*
+ * Find the row and column of the symbol of an event.
+ */
+static int parse_symbol(int c, DTMF_EVENT *ep) {
+	for (int r = 0; r < NUM_DTMF_ROW_FREQS; r++) {
+		for (int k = 0; k < NUM_DTMF_COL_FREQS; k++) {
+			if (*(*(dtmf_symbol_names + r) + k) == c) {
+				ep->row = r;
+				ep->col = k;
+				return 0;
+			}
+		}
+	}
+	return EOF;
+}
+
+/*
+ * Parse the event on the next line of the script.
+ *
+ *   @return 1 if an event was parsed, 0 at the end of the script, EOF on error.
+ */
+static int parse_event(DTMF_EVENT_READER *rp, DTMF_EVENT *ep) {
+	int c = next_char(rp);
+	if (c == EOF) {
+		return 0;
+	}
+	rp->pos--;
+	if (parse_index(rp, &ep->start) == EOF || parse_index(rp, &ep->end) == EOF) {
+		return EOF;
+	}
+	if (ep->start < rp->last_end || ep->start > ep->end || ep->end > rp->length) {
+		debug("Event %u-%u is out of order or out of range", ep->start, ep->end);
+		return EOF;
+	}
+	if (parse_symbol(next_char(rp), ep) == EOF) {
+		return EOF;
+	}
+	next_char(rp);  // The newline.
+	rp->last_end = ep->end;
+	return 1;
+}
+
+void dtmf_events_init(DTMF_EVENT_READER *rp, FILE *in, uint32_t length) {
+	rp->in = in;
+	rp->length = length;
+	rp->last_end = 0;
+	rp->done = 0;
+	rp->count = 0;
+	rp->pos = 0;
+	rp->fill = 0;
+}
+
+int dtmf_events_read(DTMF_EVENT_READER *rp) {
+	rp->count = 0;
+	while (!rp->done && rp->count < DTMF_EVENT_CHUNK) {
+		int ret = parse_event(rp, rp->events + rp->count);
+		if (ret == EOF) {
+			return EOF;
+		}
+		if (ret == 0) {
+			rp->done = 1;
+			break;
+		}
+		rp->count++;
+		// Nothing can follow an event that ends with the audio.
+		if (rp->last_end == rp->length) {
+			rp->done = 1;
+		}
+	}
+	return rp->count;
+}
+
+DTMF_EVENT *dtmf_events_read_all(FILE *in, uint32_t length, size_t *countp) {
+	DTMF_EVENT_READER *rp = malloc(sizeof(DTMF_EVENT_READER));
+	DTMF_EVENT *events = malloc(DTMF_EVENT_CHUNK * sizeof(DTMF_EVENT));
+	size_t count = 0, capacity = DTMF_EVENT_CHUNK;
+	if (!rp || !events) {
+		free(rp);
+		free(events);
+		return NULL;
+	}
+	dtmf_events_init(rp, in, length);
+	while (!rp->done) {
+		int n = dtmf_events_read(rp);
+		if (n == EOF) {
+			free(rp);
+			free(events);
+			return NULL;
+		}
+		if (count + n > capacity) {
+			capacity *= 2;
+			DTMF_EVENT *more = realloc(events, capacity * sizeof(DTMF_EVENT));
+			if (!more) {
+				free(rp);
+				free(events);
+				return NULL;
+			}
+			events = more;
+		}
+		for (int e = 0; e < n; e++) {
+			*(events + count++) = *(rp->events + e);
+		}
+	}
+	free(rp);
+	*countp = count;
+	return events;
+}
+
+/*
+ * Generate a span without noise, copying the samples of a tone from its table.
+ */
+static int render_span_pcm(AUDIO_MIXER *mp, int16_t *table, uint32_t period, uint32_t i,
+			   uint32_t end) {
+	uint32_t phase = table ? i % period : 0;
+	while (i < end) {
+		size_t room;
+		int16_t *space = audio_mixer_pcm_space(mp, &room);
+		uint32_t n = end - i < room ? end - i : room;
+		if (table) {
+			for (uint32_t k = 0; k < n; ) {
+				uint32_t run = period - phase < n - k ? period - phase : n - k;
+				// Plain copies, which the compiler turns into memcpy().
+				int16_t *src = table + phase;
+				for (uint32_t r = 0; r < run; r++) {
+					*(space + k + r) = *(src + r);
+				}
+				k += run;
+				phase = phase + run == period ? 0 : phase + run;
+			}
+		} else {
+			for (uint32_t k = 0; k < n; k++) {
+				*(space + k) = 0;
+			}
+		}
+		if (audio_mixer_commit_pcm(mp, n) == EOF) {
+			return EOF;
+		}
+		i += n;
+	}
+	return 0;
+}
+
+/*
+ * Generate the samples from index i up to, but not including, index end: the tone
+ * of an event, or silence if there is no event.
+ */
+static int render_span(AUDIO_MIXER *mp, DTMF_EVENT *ep, uint32_t i, uint32_t end) {
+	if (!mp->noise) {
+		int16_t *table = NULL;
+		uint32_t period = 0;
+		if (ep) {
+			table = dtmf_synth_table(ep->row, ep->col, &period);
+		}
+		if (!ep || table) {
+			return render_span_pcm(mp, table, period, i, end);
+		}
+	}
+	double audio_frame_rate = 8000;
+	double angular_row_freq = 0;
+	double angular_col_freq = 0;
+	if (ep) {
+		angular_row_freq = 2.0*M_PI*(*(dtmf_freqs + ep->row))/audio_frame_rate;
+		angular_col_freq = 2.0*M_PI*(*(dtmf_freqs + NUM_DTMF_ROW_FREQS + ep->col))/audio_frame_rate;
+	}
+	while (i < end) {
+		size_t room;
+		double *space = audio_mixer_space(mp, &room);
+		uint32_t n = end - i < room ? end - i : room;
+		if (ep) {
+			dtmf_synth_span(angular_row_freq, angular_col_freq, i, n, space);
+		} else {
+			for (uint32_t k = 0; k < n; k++) {
+				*(space + k) = 0;
+			}
+		}
+		if (audio_mixer_commit(mp, n) == EOF) {
+			return EOF;
+		}
+		i += n;
+	}
+	return 0;
+}
+
+int dtmf_events_render(AUDIO_MIXER *mp, DTMF_EVENT *events, size_t n, uint32_t lo, uint32_t hi) {
+	// The ends of the events are in order too: find the first that ends in the range.
+	size_t first = 0, last = n;
+	while (first < last) {
+		size_t mid = first + (last - first) / 2;
+		if ((events + mid)->end <= lo) {
+			first = mid + 1;
+		} else {
+			last = mid;
+		}
+	}
+	uint32_t i = lo;
+	for (size_t e = first; e < n && i < hi; e++) {
+		DTMF_EVENT *ep = events + e;
+		uint32_t start = ep->start > i ? (ep->start < hi ? ep->start : hi) : i;
+		uint32_t end = ep->end < hi ? ep->end : hi;
+		if (render_span(mp, NULL, i, start) == EOF ||
+		    render_span(mp, ep, start, end) == EOF) {
+			return EOF;
+		}
+		i = end > start ? end : start;
+	}
+	return render_span(mp, NULL, i, hi);
+}
@@ -0,0 +1,13 @@
+#include <stdio.h>
+
+#include "dtmf_options.h"
+
+int hop_size;
+int refine_size;
+int fixed_point;
+char *batch_file;
+int num_jobs;
+char *tones_file;
+struct tone_spec *tone_spec;
+int queue_depth;
+char *trace_file;
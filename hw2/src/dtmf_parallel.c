@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <math.h>
+#include <sys/stat.h>
+
+#include "audio.h"
+#include "audio_bulk.h"
+#include "audio_noise.h"
+#include "const.h"
+#include "debug.h"
+#include "dtmf_events.h"
+#include "dtmf_detector.h"
+#include "dtmf_channels.h"
+#include "dtmf_parallel.h"
+
+/*
+ * A maximal sequence of consecutive blocks in which the same symbol (or no symbol)
+ * was found.
+ */
+typedef struct block_run {
+	char symbol;
+	uint32_t nblocks;
+} BLOCK_RUN;
+
+/*
+ * The range of blocks analyzed by one thread, and the results.
+ */
+typedef struct chunk {
+	int fd;                  // Descriptor of the audio file.
+	off_t data_start;        // Offset of the first sample in the file.
+	DTMF_DETECTOR *detector; // Detector of this thread, used only to analyze blocks.
+	uint32_t encoding;       // Encoding of the samples in the file.
+	uint32_t first_block;    // Index of the first block in the range.
+	uint32_t nblocks;        // Number of blocks in the range.
+	BLOCK_RUN *runs;         // Results for the blocks, in order.
+	int nruns;
+	int capacity;
+	int threaded;            // Nonzero if a thread was created for the range.
+	int status;              // 0 if all blocks were analyzed, otherwise EOF.
+} CHUNK;
+
+static int chunk_add(CHUNK *cp, char symbol) {
+	if (cp->nruns > 0 && (cp->runs + cp->nruns - 1)->symbol == symbol) {
+		(cp->runs + cp->nruns - 1)->nblocks += 1;
+		return 0;
+	}
+	if (cp->nruns == cp->capacity) {
+		int capacity = cp->capacity ? 2 * cp->capacity : 64;
+		BLOCK_RUN *runs = realloc(cp->runs, capacity * sizeof(BLOCK_RUN));
+		if (!runs) {
+			return EOF;
+		}
+		cp->runs = runs;
+		cp->capacity = capacity;
+	}
+	(cp->runs + cp->nruns)->symbol = symbol;
+	(cp->runs + cp->nruns)->nblocks = 1;
+	cp->nruns += 1;
+	return 0;
+}
+
+static void *chunk_worker(void *arg) {
+	CHUNK *cp = arg;
+	uint32_t N = cp->detector->block_size;
+	// Read as many whole blocks at a time as fit in a bulk chunk.
+	uint32_t window = AUDIO_BULK_CHUNK / N > 0 ? AUDIO_BULK_CHUNK / N : 1;
+	size_t width = audio_encoding_bytes(cp->encoding);
+	uint8_t *data = malloc(window * N * width);
+	int16_t *samples = malloc(window * N * sizeof(int16_t));
+
+	cp->status = (data && samples) ? 0 : EOF;
+	uint32_t done = 0;
+	while (cp->status == 0 && done < cp->nblocks) {
+		uint32_t count = cp->nblocks - done < window ? cp->nblocks - done : window;
+		size_t bytes = (size_t)count * N * width;
+		off_t offset = cp->data_start + (off_t)(cp->first_block + done) * N * width;
+		if (pread(cp->fd, data, bytes, offset) != bytes) {
+			cp->status = EOF;
+			break;
+		}
+		audio_decode_encoded(data, cp->encoding, samples, (size_t)count * N);
+		for (uint32_t b = 0; b < count; b++) {
+			char symbol = dtmf_detector_analyze(cp->detector, samples + b * N);
+			if (chunk_add(cp, symbol) == EOF) {
+				cp->status = EOF;
+				break;
+			}
+		}
+		done += count;
+	}
+	free(data);
+	free(samples);
+	return NULL;
+}
+
+/*
+ * Leave the strengths for the last block analyzed where dtmf_detect() leaves them.
+ */
+static void keep_strengths(DTMF_DETECTOR *dp) {
+	double *strengths = dtmf_detector_strengths(dp);
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		*(goertzel_strengths + i) = *(strengths + i);
+	}
+}
+
+int dtmf_detect_parallel(FILE *audio_in, FILE *events_out, int jobs, uint32_t block_size,
+			 int fixed) {
+	AUDIO_HEADER header;
+	if (audio_read_header(audio_in, &header) == EOF) {
+		return EOF;
+	}
+	if (header.channels > 1) {
+		// The channels are analyzed together, in a single pass over the frames.
+		DTMF_CHANNELS *cp = dtmf_channels_create(block_size, header.sample_rate,
+							 header.channels, events_out);
+		DTMF_DETECT_OPTIONS options = { 0 };
+		options.fixed = fixed;
+		if (!cp || dtmf_channels_configure(cp, &options, header.encoding) == EOF) {
+			if (cp) {
+				dtmf_channels_destroy(cp);
+			}
+			return EOF;
+		}
+		int ret = dtmf_channels_run(cp, audio_in);
+		keep_strengths(*cp->detectors);
+		dtmf_channels_destroy(cp);
+		return ret;
+	}
+	DTMF_DETECTOR *dp = dtmf_detector_create(block_size, header.sample_rate, events_out);
+	if (!dp || dtmf_detector_set_fixed(dp, fixed) == EOF ||
+	    dtmf_detector_set_encoding(dp, header.encoding) == EOF) {
+		if (dp) {
+			dtmf_detector_destroy(dp);
+		}
+		return EOF;
+	}
+
+	struct stat st;
+	int fd = fileno(audio_in);
+	off_t data_start = ftello(audio_in);
+	if (jobs < 2 || dp->decimator || fd < 0 || data_start < 0 || fstat(fd, &st) == -1 || !S_ISREG(st.st_mode)) {
+		// The samples can only be read (or, if they must be converted, analyzed) in sequence.
+		int ret = dtmf_detector_run(dp, audio_in);
+		keep_strengths(dp);
+		dtmf_detector_destroy(dp);
+		return ret;
+	}
+
+	uint64_t total = st.st_size > data_start ?
+		(st.st_size - data_start) / audio_encoding_bytes(header.encoding) : 0;
+	uint32_t nblocks = total / block_size;
+	uint32_t per_job = (nblocks + jobs - 1) / jobs;
+	CHUNK *chunks = calloc(jobs, sizeof(CHUNK));
+	pthread_t *threads = calloc(jobs, sizeof(pthread_t));
+	int ret = (chunks && threads) ? 0 : EOF;
+
+	// Each range has a detector of its own, which shares the plan of dp.
+	for (int i = 0; ret == 0 && i < jobs; i++) {
+		CHUNK *cp = chunks + i;
+		cp->detector = dtmf_detector_create(block_size, header.sample_rate, NULL);
+		if (!cp->detector || dtmf_detector_set_fixed(cp->detector, fixed) == EOF) {
+			ret = EOF;
+		}
+	}
+	int started = 0;
+	for (int i = 0; ret == 0 && i < jobs; i++) {
+		CHUNK *cp = chunks + i;
+		cp->fd = fd;
+		cp->data_start = data_start;
+		cp->encoding = header.encoding;
+		cp->first_block = i * per_job < nblocks ? i * per_job : nblocks;
+		cp->nblocks = nblocks - cp->first_block < per_job ? nblocks - cp->first_block : per_job;
+		if (pthread_create(threads + i, NULL, chunk_worker, cp) != 0) {
+			// Do this range here, rather than failing.
+			chunk_worker(cp);
+		} else {
+			cp->threaded = 1;
+			started += 1;
+		}
+	}
+	for (int i = 0; chunks && i < jobs; i++) {
+		if ((chunks + i)->threaded) {
+			pthread_join(*(threads + i), NULL);
+		}
+	}
+
+	// Combine the results of the ranges in order, as a single detector would
+	// have seen them.
+	uint32_t skipped = 0;
+	DTMF_DETECTOR *last = dp;
+	for (int i = 0; ret == 0 && i < jobs; i++) {
+		CHUNK *cp = chunks + i;
+		skipped += cp->detector->blocks_skipped;
+		if (cp->nblocks > 0) {
+			last = cp->detector;
+		}
+		if (cp->status == EOF) {
+			ret = EOF;
+			break;
+		}
+		for (int r = 0; r < cp->nruns; r++) {
+			if (dtmf_detector_replay(dp, (cp->runs + r)->symbol,
+						 (cp->runs + r)->nblocks) == EOF) {
+				ret = EOF;
+			}
+		}
+	}
+	if (ret == 0) {
+		// Samples in an incomplete final block are not analyzed, but they
+		// still count towards the end of the last event.
+		dp->samples += total - (uint64_t)nblocks * block_size;
+		ret = dtmf_detector_finish(dp);
+		keep_strengths(last);
+	}
+	debug("Analyzed %u blocks using %d threads, skipped %u as silent", nblocks, started, skipped);
+
+	for (int i = 0; chunks && i < jobs; i++) {
+		free((chunks + i)->runs);
+		if ((chunks + i)->detector) {
+			dtmf_detector_destroy((chunks + i)->detector);
+		}
+	}
+	free(chunks);
+	free(threads);
+	dtmf_detector_destroy(dp);
+	return ret;
+}
+
+/*
+ * The range of samples generated by one thread.
+ */
+typedef struct span {
+	int fd;                  // Descriptor of the output file.
+	off_t data_start;        // Offset of sample 0 in the file.
+	DTMF_EVENT *events;      // All of the events, shared by the threads.
+	size_t nevents;
+	AUDIO_NOISE *noise;      // The noise, or NULL, shared by the threads.
+	double w;                // Weight of the noise.
+	uint32_t lo, hi;         // The range of sample indices.
+	int threaded;            // Nonzero if a thread was created for the range.
+	int status;              // 0 if all the samples were written, otherwise EOF.
+} SPAN;
+
+static void *span_worker(void *arg) {
+	SPAN *sp = arg;
+	AUDIO_MIXER *mixer = malloc(sizeof(AUDIO_MIXER));
+	if (!mixer) {
+		sp->status = EOF;
+		return NULL;
+	}
+	audio_mixer_init_at(mixer, sp->fd, sp->data_start, sp->noise, sp->w, sp->lo);
+	sp->status = dtmf_events_render(mixer, sp->events, sp->nevents, sp->lo, sp->hi);
+	if (sp->status == 0) {
+		sp->status = audio_mixer_flush(mixer);
+	}
+	audio_mixer_fini(mixer);
+	free(mixer);
+	return NULL;
+}
+
+int dtmf_generate_parallel(FILE *events_in, FILE *audio_out, uint32_t length, int jobs) {
+	struct stat st;
+	int fd = fileno(audio_out);
+	int flags = fd < 0 ? -1 : fcntl(fd, F_GETFL);
+	if (jobs < 2 || flags == -1 || (flags & O_APPEND) || fstat(fd, &st) == -1 ||
+	    !S_ISREG(st.st_mode)) {
+		// The samples can only be written in sequence.
+		return dtmf_generate(events_in, audio_out, length);
+	}
+
+	AUDIO_HEADER header;
+	header.magic_number = AUDIO_MAGIC;
+	header.data_offset = AUDIO_DATA_OFFSET;
+	header.data_size = length * AUDIO_BYTES_PER_SAMPLE;
+	header.encoding = PCM16_ENCODING;
+	header.sample_rate = AUDIO_FRAME_RATE;
+	header.channels = AUDIO_CHANNELS;
+	if (audio_write_header(audio_out, &header) == EOF || fflush(audio_out) == EOF) {
+		return EOF;
+	}
+	off_t data_start = ftello(audio_out);
+	if (data_start < 0 ||
+	    ftruncate(fd, data_start + (off_t)length * AUDIO_BYTES_PER_SAMPLE) == -1) {
+		return EOF;
+	}
+
+	size_t nevents = 0;
+	DTMF_EVENT *events = length ? dtmf_events_read_all(events_in, length, &nevents) :
+		malloc(sizeof(DTMF_EVENT));
+	if (!events) {
+		return EOF;
+	}
+	AUDIO_NOISE *noise = NULL;
+	if (noise_file && !(noise = audio_noise_open(noise_file))) {
+		free(events);
+		return EOF;
+	}
+	double temp = pow(10, noise_level/10.0);
+	double w = temp/(1.0+temp);
+
+	// Ranges are whole mixer buffers, so that the threads write in the same pieces
+	// as dtmf_generate() does.
+	uint32_t nbuffers = (length + AUDIO_BULK_CHUNK - 1) / AUDIO_BULK_CHUNK;
+	uint32_t per_job = (nbuffers + jobs - 1) / jobs * AUDIO_BULK_CHUNK;
+	SPAN *spans = calloc(jobs, sizeof(SPAN));
+	pthread_t *threads = calloc(jobs, sizeof(pthread_t));
+	int ret = (spans && threads) ? 0 : EOF;
+
+	int started = 0;
+	for (int i = 0; ret == 0 && i < jobs; i++) {
+		SPAN *sp = spans + i;
+		sp->fd = fd;
+		sp->data_start = data_start;
+		sp->events = events;
+		sp->nevents = nevents;
+		sp->noise = noise;
+		sp->w = w;
+		sp->lo = (uint64_t)i * per_job < length ? i * per_job : length;
+		sp->hi = length - sp->lo < per_job ? length : sp->lo + per_job;
+		if (pthread_create(threads + i, NULL, span_worker, sp) != 0) {
+			// Do this range here, rather than failing.
+			span_worker(sp);
+		} else {
+			sp->threaded = 1;
+			started += 1;
+		}
+	}
+	for (int i = 0; spans && i < jobs; i++) {
+		if ((spans + i)->threaded) {
+			pthread_join(*(threads + i), NULL);
+		}
+	}
+	for (int i = 0; ret == 0 && i < jobs; i++) {
+		if ((spans + i)->status == EOF) {
+			ret = EOF;
+		}
+	}
+	debug("Generated %u samples of %zu events using %d threads", length, nevents, started);
+
+	// The file position is left after the samples, as if they had been written in order.
+	if (ret == 0 &&
+	    fseeko(audio_out, data_start + (off_t)length * AUDIO_BYTES_PER_SAMPLE, SEEK_SET) == -1) {
+		ret = EOF;
+	}
+	audio_noise_close(noise);
+	free(events);
+	free(spans);
+	free(threads);
+	return ret;
+}
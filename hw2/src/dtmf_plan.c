@@ -0,0 +1,94 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "debug.h"
+#include "dtmf_plan.h"
+#include "goertzel_kernel.h"
+
+/*
+ * Address of the value for filter i within an array of plan vectors.
+ */
+#define PLAN_LANE(vp, i) ((double *)(vp) + (i))
+
+/*
+ * Cache of plans, searched by dtmf_plan_get().  Plans are only ever added
+ * to the front of the list, under the protection of the mutex.
+ */
+static DTMF_PLAN *plan_cache;
+static pthread_mutex_t plan_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+DTMF_PLAN *dtmf_plan_create(uint32_t N, uint32_t rate, int *freqs) {
+	DTMF_PLAN *pp = malloc(sizeof(DTMF_PLAN));
+	if (!pp) {
+		return NULL;
+	}
+	pp->N = N;
+	pp->rate = rate;
+	pp->NN = N * N;
+	pp->next = NULL;
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		// Same expressions as goertzel_init() and goertzel_strength().
+		double k = *(freqs + i) / (double)rate * N;
+		double A = 2 * M_PI * k / N;
+		double B = 2 * cos(A);
+		double d = 2 * M_PI * k * (N - 1) / N;
+		*(pp->freqs + i) = *(freqs + i);
+		*(pp->k + i) = k;
+		*(pp->A + i) = A;
+		*PLAN_LANE(pp->B, i) = B;
+		*PLAN_LANE(pp->re_C, i) = B / 2;
+		*PLAN_LANE(pp->im_C, i) = -sin(A);
+		*PLAN_LANE(pp->re_D, i) = cos(d);
+		*PLAN_LANE(pp->im_D, i) = -sin(d);
+		*((int32_t *)&pp->B_fixed + i) = lround(B * (1 << GOERTZEL_FIXED_BITS));
+	}
+	goertzel_kernel_select(pp);
+	debug("Created plan for N = %u, rate = %u%s", N, rate,
+	      pp->bank_kernel ? " (specialized kernel)" : "");
+	return pp;
+}
+
+void dtmf_plan_destroy(DTMF_PLAN *pp) {
+	free(pp);
+}
+
+static int plan_matches(DTMF_PLAN *pp, uint32_t N, uint32_t rate, int *freqs) {
+	if (pp->N != N || pp->rate != rate) {
+		return 0;
+	}
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		if (*(pp->freqs + i) != *(freqs + i)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+DTMF_PLAN *dtmf_plan_get(uint32_t N, uint32_t rate, int *freqs) {
+	pthread_mutex_lock(&plan_cache_mutex);
+	DTMF_PLAN *pp = plan_cache;
+	while (pp && !plan_matches(pp, N, rate, freqs)) {
+		pp = pp->next;
+	}
+	if (!pp) {
+		pp = dtmf_plan_create(N, rate, freqs);
+		if (pp) {
+			pp->next = plan_cache;
+			plan_cache = pp;
+		}
+	}
+	pthread_mutex_unlock(&plan_cache_mutex);
+	return pp;
+}
+
+void dtmf_plan_cache_clear(void) {
+	pthread_mutex_lock(&plan_cache_mutex);
+	while (plan_cache) {
+		DTMF_PLAN *pp = plan_cache;
+		plan_cache = pp->next;
+		dtmf_plan_destroy(pp);
+	}
+	pthread_mutex_unlock(&plan_cache_mutex);
+}
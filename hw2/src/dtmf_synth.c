@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "audio.h"
+#include "debug.h"
+#include "dtmf.h"
+#include "dtmf_synth.h"
+
+typedef double synth_vec __attribute__ ((vector_size (DTMF_SYNTH_LANES * sizeof(double))));
+
+/*
+ * Vector type used to store samples into arrays of doubles that need not be
+ * aligned on a vector boundary.
+ */
+typedef double synth_uvec __attribute__ ((vector_size (sizeof(synth_vec)), aligned (sizeof(double))));
+
+/*
+ * Synthesize at most DTMF_SYNTH_SPAN samples, restarting the oscillators from cos().
+ */
+static void synth_span(double w_row, double w_col, uint32_t start, uint32_t n, double *out) {
+	// Starting values: the first two samples of every lane.
+	synth_vec r0, r1, c0, c1;
+	for (int l = 0; l < DTMF_SYNTH_LANES; l++) {
+		double i0 = start + l;
+		double i1 = start + l + DTMF_SYNTH_LANES;
+		*((double *)&r0 + l) = cos(w_row * i0);
+		*((double *)&r1 + l) = cos(w_row * i1);
+		*((double *)&c0 + l) = cos(w_col * i0);
+		*((double *)&c1 + l) = cos(w_col * i1);
+	}
+	double k_row = 2 * cos(w_row * DTMF_SYNTH_LANES);
+	double k_col = 2 * cos(w_col * DTMF_SYNTH_LANES);
+
+	uint32_t i = 0;
+	for (; i + DTMF_SYNTH_LANES <= n; i += DTMF_SYNTH_LANES) {
+		// Same expression as in dtmf_generate() originally.
+		*(synth_uvec *)(out + i) = (r0 * 0.5 + c0 * 0.5) * INT16_MAX;
+		synth_vec r2 = k_row * r1 - r0;
+		synth_vec c2 = k_col * c1 - c0;
+		r0 = r1;
+		r1 = r2;
+		c0 = c1;
+		c1 = c2;
+	}
+	for (int l = 0; i < n; i++, l++) {
+		*(out + i) = (*((double *)&r0 + l) * 0.5 + *((double *)&c0 + l) * 0.5) * INT16_MAX;
+	}
+}
+
+void dtmf_synth_span(double w_row, double w_col, uint32_t start, uint32_t n, double *out) {
+	while (n > 0) {
+		// Spans begin at multiples of DTMF_SYNTH_SPAN, so that a sample does not
+		// depend on how the samples of a tone are divided between calls.
+		uint32_t count = DTMF_SYNTH_SPAN - start % DTMF_SYNTH_SPAN;
+		if (count > n) {
+			count = n;
+		}
+		synth_span(w_row, w_col, start, count, out);
+		start += count;
+		out += count;
+		n -= count;
+	}
+}
+
+/*
+ * The tables of the tones, built as they are first needed.
+ */
+static int16_t *synth_tables[NUM_DTMF_ROW_FREQS * NUM_DTMF_COL_FREQS];
+static uint32_t synth_periods[NUM_DTMF_ROW_FREQS * NUM_DTMF_COL_FREQS];
+static pthread_mutex_t synth_tables_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t synth_gcd(uint32_t a, uint32_t b) {
+	while (b != 0) {
+		uint32_t t = a % b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+/*
+ * Number of samples in which a frequency completes a whole number of cycles.
+ */
+static uint32_t synth_period(uint32_t freq) {
+	return AUDIO_FRAME_RATE / synth_gcd(freq, AUDIO_FRAME_RATE);
+}
+
+int16_t *dtmf_synth_table(int row, int col, uint32_t *periodp) {
+	int s = row * NUM_DTMF_COL_FREQS + col;
+	pthread_mutex_lock(&synth_tables_mutex);
+	if (!*(synth_tables + s)) {
+		uint32_t f_row = *(dtmf_freqs + row);
+		uint32_t f_col = *(dtmf_freqs + NUM_DTMF_ROW_FREQS + col);
+		uint32_t p_row = synth_period(f_row), p_col = synth_period(f_col);
+		uint32_t period = p_row / synth_gcd(p_row, p_col) * p_col;
+		int16_t *table = malloc(period * sizeof(int16_t));
+		for (uint32_t i = 0; table && i < period; i++) {
+			// f * i cycles, of which only the fraction matters.
+			double a_row = 2.0 * M_PI * ((uint64_t)f_row * i % AUDIO_FRAME_RATE) / AUDIO_FRAME_RATE;
+			double a_col = 2.0 * M_PI * ((uint64_t)f_col * i % AUDIO_FRAME_RATE) / AUDIO_FRAME_RATE;
+			*(table + i) = (int)((cos(a_row) * 0.5 + cos(a_col) * 0.5) * INT16_MAX);
+		}
+		*(synth_tables + s) = table;
+		*(synth_periods + s) = period;
+	}
+	int16_t *table = *(synth_tables + s);
+	*periodp = *(synth_periods + s);
+	pthread_mutex_unlock(&synth_tables_mutex);
+	return table;
+}
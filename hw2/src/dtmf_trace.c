@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "debug.h"
+#include "dtmf_trace.h"
+
+/*
+ * Room left in the buffer for one record, of either format.
+ */
+#define TRACE_RECORD_MAX 512
+
+char *dtmf_trace_reasons[DTMF_BLOCK_REASONS] = {
+	"ok", "silent", "weak", "twist", "row_margin", "col_margin"
+};
+
+static void trace_flush(DTMF_TRACE *tp) {
+	if (tp->fill > 0 && fwrite(tp->buffer, 1, tp->fill, tp->out) != tp->fill) {
+		tp->error = 1;
+	}
+	tp->fill = 0;
+}
+
+static void trace_append(DTMF_TRACE *tp, void *data, size_t len) {
+	uint8_t *src = data;
+	uint8_t *dst = (uint8_t *)tp->buffer + tp->fill;
+	for (size_t i = 0; i < len; i++) {
+		*(dst + i) = *(src + i);
+	}
+	tp->fill += len;
+}
+
+DTMF_TRACE *dtmf_trace_open(char *path, uint32_t block_size) {
+	size_t len = 0;
+	while (*(path + len)) {
+		len++;
+	}
+	DTMF_TRACE *tp = calloc(1, sizeof(DTMF_TRACE));
+	if (!tp) {
+		return NULL;
+	}
+	tp->csv = len >= 4 && *(path + len - 4) == '.' && *(path + len - 3) == 'c' &&
+		*(path + len - 2) == 's' && *(path + len - 1) == 'v';
+	tp->buffer = malloc(DTMF_TRACE_BUFFER);
+	tp->out = fopen(path, "w");
+	if (!tp->buffer || !tp->out) {
+		fprintf(stderr, "%s: cannot create trace file\n", path);
+		if (tp->out) {
+			fclose(tp->out);
+		}
+		free(tp->buffer);
+		free(tp);
+		return NULL;
+	}
+	if (tp->csv) {
+		tp->fill = snprintf(tp->buffer, TRACE_RECORD_MAX, "index,channel,energy");
+		for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+			tp->fill += snprintf(tp->buffer + tp->fill, TRACE_RECORD_MAX - tp->fill,
+					     ",%d", *(dtmf_freqs + f));
+		}
+		tp->fill += snprintf(tp->buffer + tp->fill, TRACE_RECORD_MAX - tp->fill,
+				     ",row,col,symbol,reason\n");
+	} else {
+		DTMF_TRACE_HEADER header;
+		for (int i = 0; i < 8; i++) {
+			*(header.magic + i) = *(DTMF_TRACE_MAGIC + i);
+		}
+		header.block_size = block_size;
+		header.record_size = sizeof(DTMF_TRACE_BLOCK);
+		trace_append(tp, &header, sizeof(header));
+	}
+	return tp;
+}
+
+void dtmf_trace_block(DTMF_TRACE *tp, DTMF_TRACE_BLOCK *bp) {
+	if (tp->fill > DTMF_TRACE_BUFFER - TRACE_RECORD_MAX) {
+		trace_flush(tp);
+	}
+	tp->records += 1;
+	if (!tp->csv) {
+		trace_append(tp, bp, sizeof(DTMF_TRACE_BLOCK));
+		return;
+	}
+	char *p = tp->buffer + tp->fill;
+	int n = snprintf(p, TRACE_RECORD_MAX, "%u,%u,%.6g", bp->index, bp->channel, bp->energy);
+	for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+		n += snprintf(p + n, TRACE_RECORD_MAX - n, ",%.6g", *(bp->strengths + f));
+	}
+	n += snprintf(p + n, TRACE_RECORD_MAX - n, ",%d,%d,", *(dtmf_freqs + bp->row),
+		      *(dtmf_freqs + bp->col));
+	if (bp->symbol) {
+		*(p + n++) = bp->symbol;
+	}
+	n += snprintf(p + n, TRACE_RECORD_MAX - n, ",%s\n", *(dtmf_trace_reasons + bp->reason));
+	tp->fill += n;
+}
+
+int dtmf_trace_close(DTMF_TRACE *tp) {
+	trace_flush(tp);
+	if (fclose(tp->out) == EOF) {
+		tp->error = 1;
+	}
+	debug("Traced %u blocks", tp->records);
+	int ret = tp->error ? EOF : 0;
+	free(tp->buffer);
+	free(tp);
+	return ret;
+}
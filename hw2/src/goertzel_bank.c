@@ -0,0 +1,134 @@
+#include <stdint.h>
+
+#include "debug.h"
+#include "goertzel_bank.h"
+
+/*
+ * Vector type used to store results into arrays of doubles that need not be
+ * aligned on a vector boundary.
+ */
+typedef double goertzel_uvec __attribute__ ((vector_size (sizeof(goertzel_vec)), aligned (sizeof(double))));
+
+_Static_assert(GOERTZEL_BANK_VECS == 2, "goertzel_bank_step() assumes two vectors per bank");
+
+void goertzel_bank_init(GOERTZEL_BANK *bp, DTMF_PLAN *pp) {
+	bp->plan = pp;
+	goertzel_bank_reset(bp);
+}
+
+void goertzel_bank_reset(GOERTZEL_BANK *bp) {
+	for (int v = 0; v < GOERTZEL_BANK_VECS; v++) {
+		*(bp->s1 + v) = (goertzel_vec){ 0 };
+		*(bp->s2 + v) = (goertzel_vec){ 0 };
+	}
+}
+
+void goertzel_bank_step(GOERTZEL_BANK *bp, double *x, uint32_t n) {
+	// Keep the state of both halves of the bank in locals for the whole
+	// block, so that the compiler can hold them in registers.
+	goertzel_vec b_lo = *(bp->plan->B), b_hi = *(bp->plan->B + 1);
+	goertzel_vec s1_lo = *(bp->s1), s1_hi = *(bp->s1 + 1);
+	goertzel_vec s2_lo = *(bp->s2), s2_hi = *(bp->s2 + 1);
+
+	for (uint32_t i = 0; i < n; i++) {
+		double xi = *(x + i);
+		goertzel_vec s0_lo = xi + b_lo * s1_lo - s2_lo;
+		goertzel_vec s0_hi = xi + b_hi * s1_hi - s2_hi;
+		s2_lo = s1_lo;
+		s2_hi = s1_hi;
+		s1_lo = s0_lo;
+		s1_hi = s0_hi;
+	}
+
+	*(bp->s1) = s1_lo;
+	*(bp->s1 + 1) = s1_hi;
+	*(bp->s2) = s2_lo;
+	*(bp->s2 + 1) = s2_hi;
+}
+
+void goertzel_bank_strengths(GOERTZEL_BANK *bp, double x, double *strengths) {
+	DTMF_PLAN *pp = bp->plan;
+	for (int v = 0; v < GOERTZEL_BANK_VECS; v++) {
+		// Same steps as goertzel_strength(), with C and D taken from the plan.
+		goertzel_vec s1 = *(bp->s1 + v);
+		goertzel_vec s0 = x + *(pp->B + v) * s1 - *(bp->s2 + v);
+		goertzel_vec re_y = s0 - s1 * *(pp->re_C + v);
+		goertzel_vec im_y = -s1 * *(pp->im_C + v);
+		goertzel_vec re_D = *(pp->re_D + v), im_D = *(pp->im_D + v);
+		goertzel_vec ry = re_y * re_D - im_y * im_D;
+		im_y = im_y * re_D + re_y * im_D;
+		re_y = ry;
+		*(goertzel_uvec *)(strengths + v * GOERTZEL_BANK_LANES) =
+			2 * (re_y * re_y + im_y * im_y) / pp->NN;
+	}
+}
+
+void goertzel_bank_block(GOERTZEL_BANK *bp, double *x, double *strengths) {
+	uint32_t N = bp->plan->N;
+	if (bp->plan->bank_kernel) {
+		bp->plan->bank_kernel(x, bp->s1, bp->s2);
+	} else {
+		goertzel_bank_reset(bp);
+		goertzel_bank_step(bp, x, N - 1);
+	}
+	goertzel_bank_strengths(bp, *(x + N - 1), strengths);
+}
+
+double goertzel_bank_energy(double *x, uint32_t n) {
+	goertzel_vec acc = { 0 };
+	uint32_t i = 0;
+	for (; i + GOERTZEL_BANK_LANES <= n; i += GOERTZEL_BANK_LANES) {
+		goertzel_vec v = *(goertzel_uvec *)(x + i);
+		acc += v * v;
+	}
+	double energy = 0;
+	for (int l = 0; l < GOERTZEL_BANK_LANES; l++) {
+		energy += *((double *)&acc + l);
+	}
+	for (; i < n; i++) {
+		energy += *(x + i) * *(x + i);
+	}
+	return energy;
+}
+
+void goertzel_slide_init(GOERTZEL_SLIDE *sp, DTMF_PLAN *pp) {
+	sp->plan = pp;
+	for (int v = 0; v < GOERTZEL_BANK_VECS; v++) {
+		*(sp->re + v) = (goertzel_vec){ 0 };
+		*(sp->im + v) = (goertzel_vec){ 0 };
+	}
+}
+
+void goertzel_slide_step(GOERTZEL_SLIDE *sp, double *x_in, double *x_out, uint32_t n) {
+	DTMF_PLAN *pp = sp->plan;
+	// exp(j * A) is the conjugate of C.
+	goertzel_vec c_re_lo = *(pp->re_C), c_re_hi = *(pp->re_C + 1);
+	goertzel_vec c_im_lo = -*(pp->im_C), c_im_hi = -*(pp->im_C + 1);
+	goertzel_vec d_re_lo = *(pp->re_D), d_re_hi = *(pp->re_D + 1);
+	goertzel_vec d_im_lo = *(pp->im_D), d_im_hi = *(pp->im_D + 1);
+	goertzel_vec re_lo = *(sp->re), re_hi = *(sp->re + 1);
+	goertzel_vec im_lo = *(sp->im), im_hi = *(sp->im + 1);
+
+	for (uint32_t i = 0; i < n; i++) {
+		double xi = *(x_in + i);
+		double xo = x_out ? *(x_out + i) : 0;
+		goertzel_vec t_lo = re_lo - xo, t_hi = re_hi - xo;
+		re_lo = t_lo * c_re_lo - im_lo * c_im_lo + xi * d_re_lo;
+		re_hi = t_hi * c_re_hi - im_hi * c_im_hi + xi * d_re_hi;
+		im_lo = t_lo * c_im_lo + im_lo * c_re_lo + xi * d_im_lo;
+		im_hi = t_hi * c_im_hi + im_hi * c_re_hi + xi * d_im_hi;
+	}
+
+	*(sp->re) = re_lo;
+	*(sp->re + 1) = re_hi;
+	*(sp->im) = im_lo;
+	*(sp->im + 1) = im_hi;
+}
+
+void goertzel_slide_strengths(GOERTZEL_SLIDE *sp, double *strengths) {
+	for (int v = 0; v < GOERTZEL_BANK_VECS; v++) {
+		goertzel_vec re = *(sp->re + v), im = *(sp->im + v);
+		*(goertzel_uvec *)(strengths + v * GOERTZEL_BANK_LANES) =
+			2 * (re * re + im * im) / sp->plan->NN;
+	}
+}
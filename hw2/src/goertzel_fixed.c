@@ -0,0 +1,61 @@
+#include <stdint.h>
+
+#include "debug.h"
+#include "goertzel_fixed.h"
+
+typedef int64_t goertzel_lvec __attribute__ ((vector_size (NUM_DTMF_FREQS * sizeof(int64_t))));
+
+/*
+ * Vector type used to load samples that need not be aligned on a vector boundary.
+ */
+typedef int16_t pcm_uvec __attribute__ ((vector_size (8 * sizeof(int16_t)), aligned (sizeof(int16_t))));
+typedef int32_t energy_vec __attribute__ ((vector_size (8 * sizeof(int32_t))));
+typedef int64_t energy_lvec __attribute__ ((vector_size (8 * sizeof(int64_t))));
+
+/*
+ * Value added to a product before shifting out the fraction bits, so that it is
+ * rounded to the nearest integer.
+ */
+#define FIXED_ROUND ((int64_t)1 << (GOERTZEL_FIXED_BITS - 1))
+
+void goertzel_fixed_block(DTMF_PLAN *pp, int16_t *x, double *strengths) {
+	goertzel_lvec B = __builtin_convertvector(pp->B_fixed, goertzel_lvec);
+	goertzel_ivec s1 = { 0 }, s2 = { 0 };
+
+	for (uint32_t i = 0; i < pp->N; i++) {
+		goertzel_lvec p = B * __builtin_convertvector(s1, goertzel_lvec);
+		goertzel_ivec s0 = *(x + i) +
+			__builtin_convertvector((p + FIXED_ROUND) >> GOERTZEL_FIXED_BITS, goertzel_ivec) - s2;
+		s2 = s1;
+		s1 = s0;
+	}
+
+	// Undo the scaling of the samples by INT16_MAX, which the floating
+	// path does at the start, and divide by N * N as it does.
+	double scale = 2 / (pp->NN * INT16_MAX * INT16_MAX);
+	for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+		double a = *((int32_t *)&s1 + i);
+		double b = *((int32_t *)&s2 + i);
+		double B_i = *((int32_t *)&pp->B_fixed + i) / (double)(1 << GOERTZEL_FIXED_BITS);
+		*(strengths + i) = (a * a + b * b - B_i * a * b) * scale;
+	}
+}
+
+double goertzel_fixed_energy(int16_t *x, uint32_t n) {
+	// Each square is at most 2^30, so it can be formed in a 32-bit lane
+	// before being widened and added into a 64-bit total.
+	energy_lvec acc = { 0 };
+	uint32_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		energy_vec v = __builtin_convertvector(*(pcm_uvec *)(x + i), energy_vec);
+		acc += __builtin_convertvector(v * v, energy_lvec);
+	}
+	int64_t energy = 0;
+	for (int l = 0; l < 8; l++) {
+		energy += *((int64_t *)&acc + l);
+	}
+	for (; i < n; i++) {
+		energy += (int32_t)*(x + i) * *(x + i);
+	}
+	return energy / ((double)INT16_MAX * INT16_MAX);
+}
@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "audio.h"
+#include "debug.h"
+#include "goertzel_kernel.h"
+
+/*
+ * Coefficient B of the filter for frequency f with blocks of N samples, by the
+ * expressions of dtmf_plan_create().
+ */
+#define KERNEL_B(f, N) (2 * cos(2 * M_PI * ((f) / (double)AUDIO_FRAME_RATE * (N)) / (N)))
+
+/*
+ * The coefficients as vectors, in the order of dtmf_freqs.
+ */
+#define KERNEL_B_LO(N) { KERNEL_B(697, N), KERNEL_B(770, N), KERNEL_B(852, N), KERNEL_B(941, N) }
+#define KERNEL_B_HI(N) { KERNEL_B(1209, N), KERNEL_B(1336, N), KERNEL_B(1477, N), KERNEL_B(1633, N) }
+
+#define KERNEL_PRAGMA(x) _Pragma(#x)
+
+_Static_assert(GOERTZEL_BANK_VECS == 2, "The kernels assume two vectors per bank");
+
+/*
+ * Define the kernel for blocks of N samples, kernel_bank_N(), which is the loop of
+ * goertzel_bank_step() over the first N - 1 samples, together with
+ * kernel_coefficients_N(), which stores the coefficients it was compiled with.
+ */
+#define GOERTZEL_KERNEL(N)						\
+static void kernel_bank_##N(double *x, goertzel_vec *s1, goertzel_vec *s2) { \
+	const goertzel_vec b_lo = KERNEL_B_LO(N), b_hi = KERNEL_B_HI(N); \
+	goertzel_vec s1_lo = { 0 }, s1_hi = { 0 };			\
+	goertzel_vec s2_lo = { 0 }, s2_hi = { 0 };			\
+	KERNEL_PRAGMA(GCC unroll N)					\
+	for (uint32_t i = 0; i < N - 1; i++) {				\
+		double xi = *(x + i);					\
+		goertzel_vec s0_lo = xi + b_lo * s1_lo - s2_lo;		\
+		goertzel_vec s0_hi = xi + b_hi * s1_hi - s2_hi;		\
+		s2_lo = s1_lo;						\
+		s2_hi = s1_hi;						\
+		s1_lo = s0_lo;						\
+		s1_hi = s0_hi;						\
+	}								\
+	*s1 = s1_lo;							\
+	*(s1 + 1) = s1_hi;						\
+	*s2 = s2_lo;							\
+	*(s2 + 1) = s2_hi;						\
+}									\
+									\
+static void kernel_coefficients_##N(goertzel_vec *B) {		\
+	*B = (goertzel_vec)KERNEL_B_LO(N);				\
+	*(B + 1) = (goertzel_vec)KERNEL_B_HI(N);			\
+}
+
+GOERTZEL_KERNEL(100)
+GOERTZEL_KERNEL(160)
+GOERTZEL_KERNEL(205)
+GOERTZEL_KERNEL(256)
+
+typedef struct goertzel_kernel {
+    uint32_t N;                            // Block size for which the kernel was compiled.
+    void (*coefficients)(goertzel_vec *B); // Stores the coefficients it uses.
+    goertzel_bank_kernel *bank;
+} GOERTZEL_KERNEL;
+
+#define KERNEL_ENTRY(N) { N, kernel_coefficients_##N, kernel_bank_##N }
+
+static GOERTZEL_KERNEL kernels[] = {
+	KERNEL_ENTRY(100), KERNEL_ENTRY(160), KERNEL_ENTRY(205), KERNEL_ENTRY(256)
+};
+
+#define NUM_KERNELS (sizeof(kernels) / sizeof(*kernels))
+
+void goertzel_kernel_select(DTMF_PLAN *pp) {
+	pp->bank_kernel = NULL;
+	if (pp->rate != AUDIO_FRAME_RATE) {
+		return;
+	}
+	for (size_t k = 0; k < NUM_KERNELS; k++) {
+		GOERTZEL_KERNEL *kp = kernels + k;
+		if (kp->N != pp->N) {
+			continue;
+		}
+		goertzel_vec B[GOERTZEL_BANK_VECS];
+		kp->coefficients(B);
+		for (int i = 0; i < NUM_DTMF_FREQS; i++) {
+			if (*((double *)B + i) != *((double *)pp->B + i)) {
+				debug("Kernel for N = %u does not match the plan", pp->N);
+				return;
+			}
+		}
+		pp->bank_kernel = kp->bank;
+		return;
+	}
+}
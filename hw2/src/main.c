@@ -2,8 +2,12 @@
 #include <stdlib.h>
 
 #include "const.h"
+#include "dtmf_options.h"
 #include "debug.h"
 #include "audio.h"
+#include "dtmf_batch.h"
+#include "dtmf_parallel.h"
+#include "tone_bank.h"
 
 #ifdef _STRING_H
 #error "Do not #include <string.h>. You will get a ZERO."
@@ -21,9 +25,9 @@ AUDIO_HEADER header;
 int main(int argc, char **argv)
 {
     if(validargs(argc, argv))
-        USAGE(*argv, EXIT_FAILURE);
+        DTMF_USAGE(*argv, EXIT_FAILURE);
     if(global_options & 1)
-        USAGE(*argv, EXIT_SUCCESS);
+        DTMF_USAGE(*argv, EXIT_SUCCESS);
 
     // FILE * f = fopen("/home/student/Desktop/snahian/hw1/all941.au", "r");
     // audio_read_header(f, &header);
@@ -31,7 +35,7 @@ int main(int argc, char **argv)
     int generate_command_used = (global_options & 2) >> 1;
     if (generate_command_used) {
         // -g flag was used
-        if (dtmf_generate(stdin, stdout, audio_samples) == EOF) {
+        if (dtmf_generate_parallel(stdin, stdout, audio_samples, num_jobs) == EOF) {
             return EXIT_FAILURE;
         }
         return EXIT_SUCCESS;
@@ -40,6 +44,27 @@ int main(int argc, char **argv)
     if (detect_command_used) {
         // the -d flag was used
             // printf("WHAT\n");
+        if (tones_file && !(tone_spec = tone_spec_load(tones_file))) {
+            return EXIT_FAILURE;
+        }
+        if (batch_file) {
+            DTMF_DETECT_OPTIONS options = { 0 };
+            options.hop = hop_size;
+            options.refine = refine_size;
+            options.fixed = fixed_point;
+            options.tones = tone_spec;
+            if (dtmf_detect_batch(batch_file, stdout, num_jobs, block_size, &options) == EOF) {
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        if (num_jobs > 1 && hop_size == block_size && !tone_spec && !refine_size &&
+            !queue_depth && !trace_file) {
+            if (dtmf_detect_parallel(stdin, stdout, num_jobs, block_size, fixed_point) == EOF) {
+                return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
         if (dtmf_detect(stdin, stdout) == EOF) {
             return EXIT_FAILURE;
         }
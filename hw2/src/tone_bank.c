@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "audio_bulk.h"
+#include "debug.h"
+#include "tone_bank.h"
+
+/*
+ * Address of the value for filter i within an array of vectors.
+ */
+#define TONE_LANE(vp, i) ((double *)(vp) + (i))
+
+/*
+ * Index of a frequency in the table of a description, adding it if it is new.
+ */
+static int spec_freq(TONE_SPEC *sp, int freq) {
+	for (int i = 0; i < sp->nfreqs; i++) {
+		if (*(sp->freqs + i) == freq) {
+			return i;
+		}
+	}
+	if (sp->nfreqs == TONE_MAX_FREQS) {
+		return EOF;
+	}
+	*(sp->freqs + sp->nfreqs) = freq;
+	return sp->nfreqs++;
+}
+
+/*
+ * Parse one line of a description, from which any comment has been removed.
+ *
+ *   @return 0 if successful, EOF if the line is not valid.
+ */
+static int spec_line(TONE_SPEC *sp, char *line) {
+	char word[TONE_NAME_SIZE], name[TONE_NAME_SIZE];
+	int n = sscanf(line, "%15s", word);
+	if (n != 1) {
+		return 0;  // Nothing but white space.
+	}
+	unsigned int block;
+	double twist, margin, level;
+	int f1, f2;
+	unsigned int ms;
+	if (sscanf(line, " block %u", &block) == 1) {
+		if (block < 10 || block > 8000) {
+			return EOF;
+		}
+		sp->block_size = block;
+		return 0;
+	}
+	if (sscanf(line, " family %15s twist %lf margin %lf level %lf",
+		   name, &twist, &margin, &level) == 4) {
+		if (sp->nfamilies == TONE_MAX_FAMILIES || twist < 0 || margin < 0) {
+			return EOF;
+		}
+		TONE_FAMILY *fp = sp->families + sp->nfamilies++;
+		snprintf(fp->name, TONE_NAME_SIZE, "%s", name);
+		fp->twist = pow(10, twist / 10);
+		fp->margin = pow(10, margin / 10);
+		fp->level = pow(10, level / 10);
+		fp->members = 0;
+		return 0;
+	}
+	n = sscanf(line, " tone %15s %d %d %u", name, &f1, &f2, &ms);
+	if (n == 3) {
+		// A single frequency, followed by the duration.
+		ms = f2;
+		f2 = 0;
+	} else if (n != 4) {
+		return EOF;
+	}
+	// Frequencies from half the sample rate up cannot be told apart from lower ones.
+	if (sp->nfamilies == 0 || sp->ntones == TONE_MAX_TONES || f1 <= 0 || f2 < 0 ||
+	    f1 >= AUDIO_FRAME_RATE / 2 || f2 >= AUDIO_FRAME_RATE / 2 ||
+	    (n == 4 && f2 == 0) || f1 == f2) {
+		return EOF;
+	}
+	TONE_DEF *tp = sp->tones + sp->ntones;
+	snprintf(tp->name, TONE_NAME_SIZE, "%s", name);
+	tp->family = sp->nfamilies - 1;
+	tp->min_ms = ms;
+	tp->nfreqs = n == 4 ? 2 : 1;
+	*tp->freqs = spec_freq(sp, f1);
+	*(tp->freqs + 1) = n == 4 ? spec_freq(sp, f2) : *tp->freqs;
+	if (*tp->freqs == EOF || *(tp->freqs + 1) == EOF) {
+		return EOF;
+	}
+	TONE_FAMILY *fp = sp->families + tp->family;
+	fp->members |= (1u << *tp->freqs) | (1u << *(tp->freqs + 1));
+	sp->ntones++;
+	return 0;
+}
+
+TONE_SPEC *tone_spec_load(char *path) {
+	FILE *in = fopen(path, "r");
+	if (!in) {
+		fprintf(stderr, "%s: cannot open tone description\n", path);
+		return NULL;
+	}
+	TONE_SPEC *sp = calloc(1, sizeof(TONE_SPEC));
+	if (!sp) {
+		fclose(in);
+		return NULL;
+	}
+	sp->block_size = TONE_DEFAULT_BLOCK;
+	char *line = NULL;
+	size_t size = 0;
+	int lineno = 0;
+	while (getline(&line, &size, in) != -1) {
+		lineno++;
+		for (char *p = line; *p; p++) {
+			if (*p == '#') {
+				*p = '\0';
+				break;
+			}
+		}
+		if (spec_line(sp, line) == EOF) {
+			fprintf(stderr, "%s:%d: invalid tone description\n", path, lineno);
+			free(line);
+			fclose(in);
+			free(sp);
+			return NULL;
+		}
+	}
+	free(line);
+	fclose(in);
+	if (sp->ntones == 0) {
+		fprintf(stderr, "%s: no tones described\n", path);
+		free(sp);
+		return NULL;
+	}
+	debug("Loaded %d tones in %d families, using %d frequencies",
+	      sp->ntones, sp->nfamilies, sp->nfreqs);
+	return sp;
+}
+
+void tone_spec_free(TONE_SPEC *sp) {
+	free(sp);
+}
+
+TONE_BANK *tone_bank_create(TONE_SPEC *sp, uint32_t rate, TONE_EMIT emit, void *arg) {
+	TONE_BANK *tp = malloc(sizeof(TONE_BANK));
+	if (!tp) {
+		return NULL;
+	}
+	tp->block = malloc(sp->block_size * sizeof(double));
+	if (!tp->block) {
+		free(tp);
+		return NULL;
+	}
+	tp->spec = sp;
+	tp->N = sp->block_size;
+	tp->NN = (double)tp->N * tp->N;
+	tp->nvecs = (sp->nfreqs + TONE_BANK_LANES - 1) / TONE_BANK_LANES;
+	for (int i = 0; i < tp->nvecs * TONE_BANK_LANES; i++) {
+		// Unused lanes are given a frequency of 0, and ignored.
+		double f = i < sp->nfreqs ? *(sp->freqs + i) : 0;
+		*TONE_LANE(tp->B, i) = 2 * cos(2 * M_PI * f / rate);
+	}
+	for (int t = 0; t < sp->ntones; t++) {
+		*(tp->min_samples + t) = (uint64_t)(sp->tones + t)->min_ms * rate / 1000;
+	}
+	tp->emit = emit;
+	tp->arg = arg;
+	tone_bank_reset(tp);
+	return tp;
+}
+
+void tone_bank_reset(TONE_BANK *tp) {
+	tp->fill = 0;
+	tp->samples = 0;
+	for (int i = 0; i < TONE_MAX_FREQS; i++) {
+		*(tp->strengths + i) = 0;
+	}
+	for (int f = 0; f < TONE_MAX_FAMILIES; f++) {
+		*(tp->current + f) = -1;
+		*(tp->start + f) = 0;
+	}
+}
+
+/*
+ * Run all the filters over the block, a vector of filters at a time, and compute
+ * the strengths, scaled as by goertzel_strength().
+ */
+static void bank_filter(TONE_BANK *tp) {
+	for (int v = 0; v < tp->nvecs; v++) {
+		tone_vec B = *(tp->B + v);
+		tone_vec s1 = { 0 }, s2 = { 0 };
+		for (uint32_t i = 0; i < tp->N; i++) {
+			tone_vec s0 = *(tp->block + i) + B * s1 - s2;
+			s2 = s1;
+			s1 = s0;
+		}
+		// The squared magnitude of the output is s1^2 + s2^2 - B * s1 * s2.
+		tone_vec power = s1 * s1 + s2 * s2 - B * s1 * s2;
+		for (int l = 0; l < TONE_BANK_LANES; l++) {
+			*(tp->strengths + v * TONE_BANK_LANES + l) =
+				2 * *((double *)&power + l) / tp->NN;
+		}
+	}
+}
+
+/*
+ * Whether a tone is present in the block just analyzed.
+ */
+static int tone_present(TONE_BANK *tp, TONE_DEF *dp) {
+	TONE_FAMILY *fp = tp->spec->families + dp->family;
+	double a = *(tp->strengths + *dp->freqs);
+	double b = *(tp->strengths + *(dp->freqs + 1));
+	double weakest = a < b ? a : b;
+	if (!((dp->nfreqs == 2 ? a + b : a) >= fp->level)) {
+		return 0;
+	}
+	if (dp->nfreqs == 2 && !(a <= b * fp->twist && b <= a * fp->twist)) {
+		return 0;
+	}
+	for (int i = 0; i < tp->spec->nfreqs; i++) {
+		if ((fp->members & (1u << i)) && i != *dp->freqs && i != *(dp->freqs + 1) &&
+		    !(weakest >= *(tp->strengths + i) * fp->margin)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/*
+ * End the tone in progress in a family, if any, at the specified index, reporting
+ * it if it lasted long enough.
+ */
+static int bank_end(TONE_BANK *tp, int f, uint32_t end) {
+	int t = *(tp->current + f);
+	*(tp->current + f) = -1;
+	if (t < 0 || end - *(tp->start + f) < *(tp->min_samples + t)) {
+		return 0;
+	}
+	return tp->emit(tp->arg, (tp->spec->tones + t)->name, *(tp->start + f), end);
+}
+
+/*
+ * Analyze the block that has just been collected, which ends at index tp->samples.
+ */
+static int bank_block(TONE_BANK *tp) {
+	bank_filter(tp);
+	uint32_t block_start = tp->samples - tp->N;
+	int ret = 0;
+	for (int f = 0; f < tp->spec->nfamilies; f++) {
+		int found = -1;
+		for (int t = 0; t < tp->spec->ntones && found < 0; t++) {
+			TONE_DEF *dp = tp->spec->tones + t;
+			if (dp->family == f && tone_present(tp, dp)) {
+				found = t;
+			}
+		}
+		if (found == *(tp->current + f)) {
+			continue;
+		}
+		if (bank_end(tp, f, block_start) == EOF) {
+			ret = EOF;
+		}
+		*(tp->current + f) = found;
+		*(tp->start + f) = block_start;
+	}
+	return ret;
+}
+
+int tone_bank_feed(TONE_BANK *tp, int16_t *samples, size_t n) {
+	int ret = 0;
+	while (n > 0) {
+		uint32_t count = tp->N - tp->fill;
+		if (count > n) {
+			count = n;
+		}
+		audio_normalize_samples(samples, tp->block + tp->fill, count);
+		tp->fill += count;
+		tp->samples += count;
+		samples += count;
+		n -= count;
+		if (tp->fill == tp->N) {
+			if (bank_block(tp) == EOF) {
+				ret = EOF;
+			}
+			tp->fill = 0;
+		}
+	}
+	return ret;
+}
+
+int tone_bank_finish(TONE_BANK *tp) {
+	int ret = 0;
+	for (int f = 0; f < tp->spec->nfamilies; f++) {
+		if (bank_end(tp, f, tp->samples) == EOF) {
+			ret = EOF;
+		}
+	}
+	return ret;
+}
+
+double *tone_bank_strengths(TONE_BANK *tp) {
+	return tp->strengths;
+}
+
+void tone_bank_destroy(TONE_BANK *tp) {
+	free(tp->block);
+	free(tp);
+}
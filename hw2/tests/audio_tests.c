@@ -3,6 +3,12 @@
 #include <string.h>
 #include "const.h"
 #include "test_common.h"
+#include "audio_bulk.h"
+#include "audio_map.h"
+#include "audio_pipe.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
 
 void assert_equal_headers(AUDIO_HEADER *act, AUDIO_HEADER *exp) {
 	cr_assert_eq(act->magic_number, exp->magic_number,
@@ -144,3 +150,186 @@ Test(audio_suite, write_sample_normal, .timeout=10){
 
     free(buf);
 }
+
+/* bulk read, including an odd trailing byte */
+Test(audio_suite, read_samples_bulk, .timeout=10){
+    const int n = 1001;
+    char *buf = malloc(2 * n + 1);
+    for (int i = 0; i < 2 * n + 1; i++)
+	buf[i] = (char)(i * 37 + 11);
+    FILE *in = fmemopen(buf, 2 * n + 1, "r");
+    FILE *ref = fmemopen(buf, 2 * n + 1, "r");
+    int16_t *samples = malloc(sizeof(int16_t) * (n + 1));
+    size_t count = audio_read_samples(in, samples, n + 1);
+    cr_assert_eq(count, n, "Wrong number of samples read.  Got: %zu | Expected: %d", count, n);
+    for (int i = 0; i < n; i++) {
+	int16_t exp_sample;
+	ref_audio_read_sample(ref, &exp_sample);
+	cr_assert_eq(samples[i], exp_sample,
+		     "Sample %d not decoded correctly. Got: 0x%hx | Expected: 0x%hx",
+		     i, samples[i], exp_sample);
+    }
+    fclose(in);
+    fclose(ref);
+    free(samples);
+    free(buf);
+}
+
+/* bulk write, spanning more than one chunk */
+Test(audio_suite, write_samples_bulk, .timeout=10){
+    const int n = AUDIO_BULK_CHUNK + 7;
+    int16_t *samples = malloc(sizeof(int16_t) * n);
+    for (int i = 0; i < n; i++)
+	samples[i] = (int16_t)(i * 7919 - 30000);
+    char *content;
+    size_t size;
+    FILE *out = open_memstream(&content, &size);
+    int ret = audio_write_samples(out, samples, n);
+    fclose(out);
+    cr_assert_eq(ret, 0, "Invalid return for audio_write_samples.  Got: %d | Expected: 0", ret);
+    cr_assert_eq(size, 2 * n, "Wrong number of bytes written.  Got: %zu | Expected: %d", size, 2 * n);
+    FILE *in = fmemopen(content, size, "r");
+    for (int i = 0; i < n; i++) {
+	int16_t sample;
+	ref_audio_read_sample(in, &sample);
+	cr_assert_eq(sample, samples[i], "Sample %d not written correctly. Got: 0x%hx | Expected: 0x%hx",
+		     i, sample, samples[i]);
+    }
+    fclose(in);
+    free(content);
+    free(samples);
+}
+
+/* mapped file with an odd-length annotation, so the samples are not aligned */
+Test(audio_suite, mapped_file, .timeout=10){
+    const int n = 1001, annotation = 5;
+    AUDIO_HEADER hdr = const_hdr;
+    hdr.data_offset = AUDIO_DATA_OFFSET + annotation;
+    hdr.data_size = 2 * n;
+    const char *name = "hw1-test-output/mapped.au";
+    if (access("hw1-test-output", F_OK) == -1)
+	mkdir("hw1-test-output", 0755);
+    FILE *f = fopen(name, "w");
+    cr_assert((f != NULL), "Cannot create %s", name);
+    audio_write_header(f, &hdr);
+    fwrite("abcde", 1, annotation, f);
+    for (int i = 0; i < n; i++)
+	audio_write_sample(f, (int16_t)(i * 7919 - 30000));
+    fputc(0x55, f);    // An incomplete final sample.
+    fclose(f);
+
+    f = fopen(name, "r");
+    AUDIO_MAP map;
+    AUDIO_HEADER header_res;
+    cr_assert_eq(audio_map_open(&map, f), 0, "Cannot map %s", name);
+    cr_assert_eq(audio_map_read_header(&map, &header_res), 0, "Invalid return for audio_map_read_header");
+    assert_equal_headers(&header_res, &hdr);
+    cr_assert_eq(map.nsamples, n, "Wrong number of samples.  Got: %zu | Expected: %d", map.nsamples, n);
+
+    int16_t samples[n];
+    double x[n], x_exp[n];
+    audio_decode_samples(map.data, samples, n);
+    audio_normalize_be_samples(map.data, x, n);
+    for (int i = 0; i < n; i++)
+	cr_assert_eq(samples[i], (int16_t)(i * 7919 - 30000),
+		     "Sample %d not decoded correctly. Got: 0x%hx", i, samples[i]);
+    audio_normalize_samples(samples, x_exp, n);
+    cr_assert((memcmp(x, x_exp, sizeof(x)) == 0), "Mapped samples not scaled as read samples");
+    audio_map_close(&map);
+    fclose(f);
+
+    // Anything but a regular file is read as a stream.
+    int fds[2];
+    cr_assert_eq(pipe(fds), 0, "Cannot create pipe");
+    FILE *p = fdopen(fds[0], "r");
+    cr_assert((audio_map_open(&map, p) == EOF), "A pipe was mapped");
+    fclose(p);
+    close(fds[1]);
+}
+
+/* reading on a separate thread, with a consumer slower than the reader */
+Test(audio_suite, piped_read, .timeout=10){
+    const size_t frame_bytes = 6, len = 5 * AUDIO_PIPE_BUFFER + 1001;
+    uint8_t *buf = malloc(len);
+    for (size_t i = 0; i < len; i++)
+	buf[i] = (uint8_t)(i * 37 + 11);
+    FILE *in = fmemopen(buf, len, "r");
+    AUDIO_PIPE *pp = audio_pipe_open(in, frame_bytes, 2);
+    cr_assert((pp != NULL), "Cannot open pipe");
+    cr_assert_eq(pp->buffer_size % frame_bytes, 0, "Buffers do not hold whole frames");
+
+    // Give the reader time to fill both buffers and wait for the consumer.
+    usleep(50000);
+    size_t total = 0, n;
+    uint8_t *data;
+    while ((n = audio_pipe_next(pp, &data)) > 0) {
+	cr_assert((memcmp(data, buf + total, n) == 0), "Bytes at %zu read out of order", total);
+	total += n;
+    }
+    cr_assert_eq(total, len, "Wrong number of bytes read.  Got: %zu | Expected: %zu", total, len);
+    cr_assert_eq(audio_pipe_next(pp, &data), 0, "Data after EOF");
+    cr_assert_eq(pp->bytes, len, "Wrong byte count.  Got: %lu", (unsigned long)pp->bytes);
+    cr_assert((pp->reader_stalls > 0), "Reader never waited for the consumer");
+    char *report;
+    size_t report_len;
+    FILE *out = open_memstream(&report, &report_len);
+    audio_pipe_close(pp, out);
+    fclose(out);
+    cr_assert((strstr(report, "reader waited") != NULL), "Waits not reported: %s", report);
+    free(report);
+    fclose(in);
+
+    // The reader may also be stopped before it reaches EOF.
+    in = fmemopen(buf, len, "r");
+    pp = audio_pipe_open(in, frame_bytes, AUDIO_PIPE_MIN_DEPTH);
+    cr_assert((pp != NULL), "Cannot open pipe");
+    cr_assert((audio_pipe_next(pp, &data) > 0), "Nothing read");
+    audio_pipe_close(pp, NULL);
+    fclose(in);
+    cr_assert((audio_pipe_open(stdin, frame_bytes, AUDIO_PIPE_MAX_DEPTH + 1) == NULL),
+	      "Depth out of range accepted");
+    free(buf);
+}
+
+/* mu-law and A-law headers are accepted and the samples decoded by table */
+Test(audio_suite, g711_decode, .timeout=10){
+    cr_assert_eq(audio_mulaw_table[0xff], 0, "Wrong mu-law value for 0xff");
+    cr_assert_eq(audio_mulaw_table[0x00], -32124, "Wrong mu-law value for 0x00");
+    cr_assert_eq(audio_mulaw_table[0x80], 32124, "Wrong mu-law value for 0x80");
+    cr_assert_eq(audio_alaw_table[0xd5], 8, "Wrong A-law value for 0xd5");
+    cr_assert_eq(audio_alaw_table[0x55], -8, "Wrong A-law value for 0x55");
+    cr_assert_eq(audio_alaw_table[0xaa], 32256, "Wrong A-law value for 0xaa");
+    for (int c = 1; c < 128; c++)
+	cr_assert_eq(audio_mulaw_table[c], -audio_mulaw_table[c + 128],
+		     "mu-law codes 0x%x and 0x%x are not opposite", c, c + 128);
+
+    uint32_t encodings[] = {MULAW_ENCODING, ALAW_ENCODING};
+    const int n = AUDIO_BULK_CHUNK + 3;
+    for (int e = 0; e < 2; e++) {
+	AUDIO_HEADER hdr = const_hdr;
+	hdr.encoding = encodings[e];
+	hdr.data_size = n;
+	char *content;
+	size_t size;
+	FILE *out = open_memstream(&content, &size);
+	audio_write_header(out, &hdr);
+	for (int i = 0; i < n; i++)
+	    fputc(i * 7 & 0xff, out);
+	fclose(out);
+
+	FILE *in = fmemopen(content, size, "r");
+	AUDIO_HEADER header_res;
+	cr_assert_eq(audio_read_header(in, &header_res), 0,
+		     "Header with encoding %u rejected", encodings[e]);
+	int16_t *samples = malloc(sizeof(int16_t) * (n + 1));
+	size_t count = audio_read_encoded(in, header_res.encoding, samples, n + 1);
+	cr_assert_eq(count, n, "Wrong number of samples read.  Got: %zu | Expected: %d", count, n);
+	const int16_t *table = e ? audio_alaw_table : audio_mulaw_table;
+	for (int i = 0; i < n; i++)
+	    cr_assert_eq(samples[i], table[i * 7 & 0xff],
+			 "Sample %d not decoded correctly. Got: %d", i, samples[i]);
+	fclose(in);
+	free(samples);
+	free(content);
+    }
+}
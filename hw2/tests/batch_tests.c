@@ -0,0 +1,80 @@
+#include "test_common.h"
+#include "dtmf_batch.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define OUTPUT_DIR "hw1-test-output"
+#define BATCH_LIST OUTPUT_DIR "/batch_list.txt"
+
+static struct _dtmf_event batch_events[][2] = {
+	{{0, 1000, '1'}, {2000, 3000, '2'}},
+	{{500, 1500, 'B'}, {1500, 2500, '0'}},
+	{{100, 4000, '#'}, {5000, 6000, '*'}}};
+
+static void write_batch_file(const char *name, struct _dtmf_event *events, int n)
+{
+	size_t len = sizeof(AUDIO_HEADER) + 8000 * sizeof(int16_t);
+	char *audio = malloc(len);
+	cr_assert((audio != NULL), "Cannot malloc audio buffer");
+	generate_dtmf_audio(events, n, audio, len, NULL, 0, 0);
+	FILE *f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create audio file %s", name);
+	fwrite(audio, 1, len, f);
+	fclose(f);
+	free(audio);
+}
+
+Test(batch_suite, ordered_tagged_output, .timeout=10)
+{
+	char names[nelem(batch_events)][64];
+	if (access(OUTPUT_DIR, F_OK) == -1)
+		mkdir(OUTPUT_DIR, 0755);
+	FILE *list = fopen(BATCH_LIST, "w");
+	cr_assert((list != NULL), "Cannot create list file");
+	for (int i = 0; i < nelem(batch_events); i++) {
+		sprintf(names[i], OUTPUT_DIR "/batch_%d.au", i);
+		write_batch_file(names[i], batch_events[i], 2);
+		fprintf(list, "%s\n", names[i]);
+	}
+	fclose(list);
+
+	char expected[1024], *p = expected;
+	for (int i = 0; i < nelem(batch_events); i++) {
+		for (int e = 0; e < 2; e++) {
+			p += sprintf(p, "%s\t%u\t%u\t%c\n", names[i],
+				     batch_events[i][e].start_index,
+				     batch_events[i][e].end_index,
+				     batch_events[i][e].symbol);
+		}
+	}
+
+	DTMF_DETECT_OPTIONS options = { 0 };
+	for (int jobs = 1; jobs <= 3; jobs++) {
+		char *text;
+		size_t len;
+		FILE *out = open_memstream(&text, &len);
+		int ret = dtmf_detect_batch(BATCH_LIST, out, jobs, 100, &options);
+		fclose(out);
+		cr_assert_eq(ret, 0, "dtmf_detect_batch failed with %d jobs", jobs);
+		cr_assert((strcmp(text, expected) == 0),
+			  "Output with %d jobs differs:\n%s\nExpected:\n%s\n",
+			  jobs, text, expected);
+		free(text);
+	}
+}
+
+Test(batch_suite, missing_file, .timeout=10)
+{
+	if (access(OUTPUT_DIR, F_OK) == -1)
+		mkdir(OUTPUT_DIR, 0755);
+	FILE *list = fopen(BATCH_LIST, "w");
+	cr_assert((list != NULL), "Cannot create list file");
+	fprintf(list, "%s\n", OUTPUT_DIR "/no_such_file.au");
+	fclose(list);
+	DTMF_DETECT_OPTIONS options = { 0 };
+	FILE *out = fopen("/dev/null", "w");
+	int ret = dtmf_detect_batch(BATCH_LIST, out, 2, 100, &options);
+	fclose(out);
+	cr_assert_eq(ret, EOF, "Expected failure for missing audio file");
+}
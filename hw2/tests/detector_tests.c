@@ -0,0 +1,729 @@
+#include "test_common.h"
+#include "audio_bulk.h"
+#include "dtmf_channels.h"
+#include "dtmf_detector.h"
+#include "dtmf_options.h"
+#include "dtmf_parallel.h"
+#include "dtmf_trace.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+static struct _dtmf_event detector_events[] = {
+	{0, 1000, '0'},	   {2000, 3000, '1'}, {3000, 4000, '9'},
+	{4500, 6000, '#'}, {6100, 6200, 'D'}, {7000, 7990, 'A'}};
+
+/*
+ * Generate audio for the test events and return its samples in host byte order.
+ */
+static int16_t *make_samples(int duration_ms, size_t *np)
+{
+	size_t nsamples = duration_ms * AUDIO_FRAME_RATE / 1000;
+	size_t len = sizeof(AUDIO_HEADER) + nsamples * sizeof(int16_t);
+	char *audio = malloc(len);
+	cr_assert((audio != NULL), "Cannot malloc audio buffer");
+	generate_dtmf_audio(detector_events, nelem(detector_events), audio, len,
+			    NULL, 0, 0);
+	int16_t *samples = malloc(nsamples * sizeof(int16_t));
+	cr_assert((samples != NULL), "Cannot malloc sample buffer");
+	audio_swap_samples((int16_t *)(audio + sizeof(AUDIO_HEADER)), samples, nsamples);
+	free(audio);
+	*np = nsamples;
+	return samples;
+}
+
+/*
+ * Run dtmf_detect() on the same audio, for comparison.
+ */
+static char *reference_output(int16_t *samples, size_t n, int bsize)
+{
+	char *audio;
+	size_t audio_len;
+	FILE *f = open_memstream(&audio, &audio_len);
+	AUDIO_HEADER hdr = const_hdr;
+	hdr.data_size = n * sizeof(int16_t);
+	audio_write_header(f, &hdr);
+	audio_write_samples(f, samples, n);
+	fclose(f);
+
+	char *text;
+	size_t text_len;
+	FILE *in = fmemopen(audio, audio_len, "r");
+	FILE *out = open_memstream(&text, &text_len);
+	block_size = bsize;
+	dtmf_detect(in, out);
+	fclose(in);
+	fclose(out);
+	free(audio);
+	return text;
+}
+
+Test(detector_suite, arbitrary_feed_sizes, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	int bsize = 100;
+	char *expected = reference_output(samples, n, bsize);
+
+	size_t feed_sizes[] = {1, 7, 99, 100, 101, 333, 4096};
+	for (int f = 0; f < nelem(feed_sizes); f++) {
+		char *text;
+		size_t text_len;
+		FILE *out = open_memstream(&text, &text_len);
+		DTMF_DETECTOR *dp = dtmf_detector_create(bsize, AUDIO_FRAME_RATE, out);
+		cr_assert((dp != NULL), "Cannot create detector");
+		for (size_t i = 0; i < n; i += feed_sizes[f]) {
+			size_t count = n - i < feed_sizes[f] ? n - i : feed_sizes[f];
+			dtmf_detector_feed(dp, samples + i, count);
+		}
+		dtmf_detector_finish(dp);
+		dtmf_detector_destroy(dp);
+		fclose(out);
+		cr_assert((strcmp(text, expected) == 0),
+			  "Output with feed size %zu differs:\n%s\nExpected:\n%s\n",
+			  feed_sizes[f], text, expected);
+		free(text);
+	}
+	free(expected);
+	free(samples);
+}
+
+Test(detector_suite, interleaved_detectors, .timeout=10)
+{
+	// Two detectors with different block sizes, fed alternately,
+	// must not interfere with each other.
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	char *expected_a = reference_output(samples, n, 100);
+	char *expected_b = reference_output(samples, n, 205);
+
+	char *text_a, *text_b;
+	size_t len_a, len_b;
+	FILE *out_a = open_memstream(&text_a, &len_a);
+	FILE *out_b = open_memstream(&text_b, &len_b);
+	DTMF_DETECTOR *a = dtmf_detector_create(100, AUDIO_FRAME_RATE, out_a);
+	DTMF_DETECTOR *b = dtmf_detector_create(205, AUDIO_FRAME_RATE, out_b);
+	cr_assert((a != NULL && b != NULL), "Cannot create detectors");
+	for (size_t i = 0; i < n; i += 50) {
+		size_t count = n - i < 50 ? n - i : 50;
+		dtmf_detector_feed(a, samples + i, count);
+		dtmf_detector_feed(b, samples + i, count);
+	}
+	dtmf_detector_finish(a);
+	dtmf_detector_finish(b);
+	dtmf_detector_destroy(a);
+	dtmf_detector_destroy(b);
+	fclose(out_a);
+	fclose(out_b);
+	cr_assert((strcmp(text_a, expected_a) == 0), "Output of first detector differs");
+	cr_assert((strcmp(text_b, expected_b) == 0), "Output of second detector differs");
+	free(text_a);
+	free(text_b);
+	free(expected_a);
+	free(expected_b);
+	free(samples);
+}
+
+Test(detector_suite, parallel_matches_sequential, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	// An odd number of trailing samples, so that the last block is incomplete.
+	n -= 37;
+	const char *name = "hw1-test-output/parallel_in.au";
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+	FILE *f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create %s", name);
+	AUDIO_HEADER hdr = const_hdr;
+	hdr.data_size = n * sizeof(int16_t);
+	audio_write_header(f, &hdr);
+	audio_write_samples(f, samples, n);
+	fclose(f);
+
+	int bsizes[] = {10, 100, 205};
+	for (int b = 0; b < nelem(bsizes); b++) {
+		char *expected = reference_output(samples, n, bsizes[b]);
+		// The strengths of the last complete block, as dtmf_detect() leaves them.
+		double last[NUM_DTMF_FREQS];
+		DTMF_DETECTOR *dp = dtmf_detector_create(bsizes[b], AUDIO_FRAME_RATE, NULL);
+		cr_assert((dp != NULL), "Cannot create detector");
+		dtmf_detector_feed(dp, samples, n);
+		memcpy(last, dtmf_detector_strengths(dp), sizeof(last));
+		dtmf_detector_destroy(dp);
+		for (int jobs = 2; jobs <= 9; jobs += 7) {
+			char *text;
+			size_t len;
+			FILE *in = fopen(name, "r");
+			FILE *out = open_memstream(&text, &len);
+			memset(goertzel_strengths, 0, sizeof(goertzel_strengths));
+			int ret = dtmf_detect_parallel(in, out, jobs, bsizes[b], 0);
+			fclose(in);
+			fclose(out);
+			cr_assert_eq(ret, 0, "dtmf_detect_parallel failed");
+			cr_assert((strcmp(text, expected) == 0),
+				  "Output with %d jobs, block size %d differs:\n%s\nExpected:\n%s\n",
+				  jobs, bsizes[b], text, expected);
+			for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+				cr_assert_eq(goertzel_strengths[f], last[f],
+					     "Strength %d with %d jobs, block size %d differs: %g != %g",
+					     f, jobs, bsizes[b], goertzel_strengths[f], last[f]);
+			}
+			free(text);
+		}
+		free(expected);
+	}
+	free(samples);
+}
+
+/*
+ * Record of the tones reported to a listener.
+ */
+struct tone_log {
+	DTMF_DETECTOR *dp;
+	int nstarts, nends;
+	uint32_t starts[32];
+	uint32_t start_times[32];	// Samples fed when tone_start was called.
+	char ends[32 * 32];
+	size_t ends_len;
+};
+
+static void log_tone_start(void *arg, char symbol, uint32_t start)
+{
+	struct tone_log *lp = arg;
+	cr_assert((lp->nstarts == lp->nends), "tone_start called twice without tone_end");
+	lp->starts[lp->nstarts] = start;
+	lp->start_times[lp->nstarts] = lp->dp->samples;
+	lp->nstarts++;
+}
+
+static void log_tone_end(void *arg, char symbol, uint32_t start, uint32_t end)
+{
+	struct tone_log *lp = arg;
+	cr_assert((lp->nends + 1 == lp->nstarts), "tone_end called without tone_start");
+	cr_assert_eq(start, lp->starts[lp->nends], "tone_end start differs from tone_start");
+	lp->nends++;
+	if (end - start >= DTMF_MIN_EVENT_SAMPLES)
+		lp->ends_len += sprintf(lp->ends + lp->ends_len, "%u\t%u\t%c\n", start, end, symbol);
+}
+
+Test(detector_suite, listener_callbacks, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	int bsize = 100;
+	char *expected = reference_output(samples, n, bsize);
+
+	for (uint32_t confirm = 1; confirm <= 2; confirm++) {
+		struct tone_log log = {0};
+		DTMF_LISTENER listener = {log_tone_start, log_tone_end, &log, confirm};
+		DTMF_DETECTOR *dp = dtmf_detector_create(bsize, AUDIO_FRAME_RATE, NULL);
+		cr_assert((dp != NULL), "Cannot create detector");
+		log.dp = dp;
+		dtmf_detector_set_listener(dp, &listener);
+		for (size_t i = 0; i < n; i += 37) {
+			size_t count = n - i < 37 ? n - i : 37;
+			dtmf_detector_feed(dp, samples + i, count);
+		}
+		dtmf_detector_finish(dp);
+		dtmf_detector_destroy(dp);
+		cr_assert_eq(log.nstarts, log.nends, "Tone still open after finish");
+		// Each tone is announced as soon as its confirming block has been fed,
+		// which is within confirm + 1 blocks of its onset.
+		for (int i = 0; i < log.nstarts; i++) {
+			cr_assert((log.start_times[i] - log.starts[i] <= (confirm + 1) * bsize),
+				  "Tone starting at %u announced late, at %u",
+				  log.starts[i], log.start_times[i]);
+		}
+		cr_assert((strcmp(log.ends, expected) == 0),
+			  "Tones with confirmation %u differ:\n%s\nExpected:\n%s\n",
+			  confirm, log.ends, expected);
+	}
+	free(expected);
+	free(samples);
+}
+
+Test(detector_suite, silence_gate, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	// Scale the audio down so that some tones are close to the threshold.
+	int divisors[] = {1, 3, 10, 20, 30, 60};
+	for (int d = 0; d < nelem(divisors); d++) {
+		int16_t *scaled = malloc(n * sizeof(int16_t));
+		cr_assert((scaled != NULL), "Cannot malloc sample buffer");
+		for (size_t i = 0; i < n; i++)
+			scaled[i] = samples[i] / divisors[d];
+
+		char *text[2];
+		size_t len[2];
+		double strengths[2][NUM_DTMF_FREQS];
+		uint32_t skipped[2];
+		for (int gate = 0; gate < 2; gate++) {
+			FILE *out = open_memstream(&text[gate], &len[gate]);
+			DTMF_DETECTOR *dp = dtmf_detector_create(100, AUDIO_FRAME_RATE, out);
+			cr_assert((dp != NULL), "Cannot create detector");
+			dp->gate = gate;
+			// Stop on a block of silence, to check the strengths of a skipped block.
+			dtmf_detector_feed(dp, scaled, 6800);
+			dtmf_detector_finish(dp);
+			memcpy(strengths[gate], dtmf_detector_strengths(dp), sizeof(strengths[gate]));
+			skipped[gate] = dp->blocks_skipped;
+			dtmf_detector_destroy(dp);
+			fclose(out);
+		}
+		cr_assert_eq(skipped[0], 0, "Blocks skipped with the gate off");
+		cr_assert((skipped[1] > 0), "No blocks skipped with divisor %d", divisors[d]);
+		cr_assert((strcmp(text[0], text[1]) == 0),
+			  "Gated output with divisor %d differs:\n%s\nExpected:\n%s\n",
+			  divisors[d], text[1], text[0]);
+		cr_assert((memcmp(strengths[0], strengths[1], sizeof(strengths[0])) == 0),
+			  "Strengths of the last block differ with divisor %d", divisors[d]);
+		free(text[0]);
+		free(text[1]);
+		free(scaled);
+	}
+	free(samples);
+}
+
+Test(detector_suite, overlapping_windows, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	int bsize = 100;
+
+	// With the block size as the hop, the output is the usual one.
+	char *expected = reference_output(samples, n, bsize);
+	char *text;
+	size_t len;
+	FILE *out = open_memstream(&text, &len);
+	DTMF_DETECTOR *dp = dtmf_detector_create(bsize, AUDIO_FRAME_RATE, out);
+	cr_assert((dp != NULL), "Cannot create detector");
+	cr_assert_eq(dtmf_detector_set_hop(dp, bsize + 1), EOF, "Hop larger than block accepted");
+	cr_assert_eq(dtmf_detector_set_hop(dp, bsize), 0, "Cannot set hop");
+	dtmf_detector_feed(dp, samples, n);
+	dtmf_detector_finish(dp);
+	fclose(out);
+	cr_assert((strcmp(text, expected) == 0), "Output with hop %d differs", bsize);
+	free(text);
+	free(expected);
+
+	// With a small hop, the boundaries of the events that begin or end in silence
+	// are found much more precisely than to the nearest block.
+	uint32_t hops[] = {1, 7, 10, 25};
+	for (int h = 0; h < nelem(hops); h++) {
+		out = open_memstream(&text, &len);
+		dtmf_detector_reset(dp, out, NULL);
+		cr_assert_eq(dtmf_detector_set_hop(dp, hops[h]), 0, "Cannot set hop");
+		for (size_t i = 0; i < n; i += 333) {
+			size_t count = n - i < 333 ? n - i : 333;
+			dtmf_detector_feed(dp, samples + i, count);
+		}
+		dtmf_detector_finish(dp);
+		fclose(out);
+		uint32_t start, end;
+		char symbol;
+		int nevents = 0, offset = 0, consumed;
+		while (sscanf(text + offset, "%u\t%u\t%c\n%n", &start, &end, &symbol, &consumed) == 3) {
+			offset += consumed;
+			nevents++;
+			int found = 0;
+			for (int e = 0; e < nelem(detector_events); e++) {
+				struct _dtmf_event *ep = &detector_events[e];
+				if (ep->symbol != symbol)
+					continue;
+				found = 1;
+				// '1' and '9' are adjacent, so only their outer boundaries are checked.
+				if (symbol != '9')
+					cr_assert((abs((int)start - (int)ep->start_index) <= 30),
+						  "Hop %u: start of '%c' at %u", hops[h], symbol, start);
+				if (symbol != '1')
+					cr_assert((abs((int)end - (int)ep->end_index) <= 30),
+						  "Hop %u: end of '%c' at %u", hops[h], symbol, end);
+			}
+			cr_assert(found, "Hop %u: unexpected event %c", hops[h], symbol);
+		}
+		cr_assert_eq(nevents, 5, "Hop %u: %d events detected:\n%s", hops[h], nevents, text);
+		free(text);
+	}
+	dtmf_detector_destroy(dp);
+	free(samples);
+}
+
+Test(detector_suite, fixed_point, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	int bsizes[] = {10, 100, 205, 1000};
+	for (int b = 0; b < nelem(bsizes); b++) {
+		char *expected = reference_output(samples, n, bsizes[b]);
+		char *text;
+		size_t len;
+		FILE *out = open_memstream(&text, &len);
+		DTMF_DETECTOR *dp = dtmf_detector_create(bsizes[b], AUDIO_FRAME_RATE, out);
+		cr_assert((dp != NULL), "Cannot create detector");
+		cr_assert_eq(dtmf_detector_set_fixed(dp, 1), 0, "Cannot select fixed point");
+		for (size_t i = 0; i < n; i += 99) {
+			size_t count = n - i < 99 ? n - i : 99;
+			dtmf_detector_feed(dp, samples + i, count);
+		}
+		dtmf_detector_finish(dp);
+		dtmf_detector_destroy(dp);
+		fclose(out);
+		cr_assert((strcmp(text, expected) == 0),
+			  "Fixed-point output with block size %d differs:\n%s\nExpected:\n%s\n",
+			  bsizes[b], text, expected);
+		free(text);
+		free(expected);
+	}
+	free(samples);
+}
+
+Test(detector_suite, mulaw_input, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+
+	// Encode each sample as the nearest mu-law value.
+	uint8_t *codes = malloc(n);
+	cr_assert((codes != NULL), "Cannot malloc code buffer");
+	for (size_t i = 0; i < n; i++) {
+		int best = 0;
+		for (int c = 1; c < 256; c++) {
+			if (abs(audio_mulaw_table[c] - samples[i]) <
+			    abs(audio_mulaw_table[best] - samples[i]))
+				best = c;
+		}
+		codes[i] = best;
+		samples[i] = audio_mulaw_table[best];
+	}
+
+	const char *name = "hw1-test-output/mulaw.au";
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+	FILE *f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create %s", name);
+	AUDIO_HEADER hdr = const_hdr;
+	hdr.encoding = MULAW_ENCODING;
+	hdr.data_size = n;
+	audio_write_header(f, &hdr);
+	fwrite(codes, 1, n, f);
+	fclose(f);
+
+	// The events must be those found in the decoded samples, whether the file is
+	// mapped, read as a stream or divided among threads.
+	char *expected = reference_output(samples, n, 100);
+	for (int mode = 0; mode < 3; mode++) {
+		char *text;
+		size_t text_len;
+		FILE *out = open_memstream(&text, &text_len);
+		f = fopen(name, "r");
+		cr_assert((f != NULL), "Cannot open %s", name);
+		int ret;
+		if (mode == 0) {
+			ret = dtmf_detect(f, out);
+		} else if (mode == 1) {
+			AUDIO_HEADER header;
+			DTMF_DETECTOR *dp = dtmf_detector_create(100, AUDIO_FRAME_RATE, out);
+			cr_assert((audio_read_header(f, &header) == 0), "Header rejected");
+			cr_assert((dtmf_detector_set_encoding(dp, header.encoding) == 0),
+				  "Encoding rejected");
+			ret = dtmf_detector_run(dp, f);
+			dtmf_detector_destroy(dp);
+		} else {
+			ret = dtmf_detect_parallel(f, out, 3, 100, 0);
+		}
+		fclose(f);
+		fclose(out);
+		cr_assert((ret == 0), "Detection failed in mode %d", mode);
+		cr_assert((strcmp(text, expected) == 0),
+			  "Mode %d output differs:\n%s\nExpected:\n%s", mode, text, expected);
+		free(text);
+	}
+	free(expected);
+	free(codes);
+	free(samples);
+}
+
+Test(detector_suite, higher_rate_input, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	char *reference = reference_output(samples, n, 100);
+	static const uint32_t rates[] = {16000, 44100};
+	const char *name = "hw1-test-output/rate.au";
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+
+	for (int r = 0; r < nelem(rates); r++) {
+		// The same tones at the higher rate, with a loud tone at 6367 Hz, which
+		// would alias to 1633 Hz if it were not filtered out.
+		uint32_t rate = rates[r];
+		size_t m = n * rate / AUDIO_FRAME_RATE;
+		int16_t *wide = calloc(m, sizeof(int16_t));
+		cr_assert((wide != NULL), "Cannot malloc sample buffer");
+		for (int e = 0; e < nelem(detector_events); e++) {
+			struct _dtmf_event *ep = &detector_events[e];
+			int row = 0, col = 0;
+			for (int i = 0; i < NUM_DTMF_ROW_FREQS; i++)
+				for (int k = 0; k < NUM_DTMF_COL_FREQS; k++)
+					if (dtmf_symbol_names[i][k] == ep->symbol) {
+						row = i;
+						col = k;
+					}
+			size_t start = (size_t)ep->start_index * rate / AUDIO_FRAME_RATE;
+			size_t end = (size_t)ep->end_index * rate / AUDIO_FRAME_RATE;
+			for (size_t i = start; i < end; i++)
+				wide[i] = (cos(2 * M_PI * dtmf_freqs[row] * i / rate) +
+					   cos(2 * M_PI * dtmf_freqs[NUM_DTMF_ROW_FREQS + col] * i / rate)) *
+					INT16_MAX / 4;
+		}
+		for (size_t i = 0; i < m; i++)
+			wide[i] += cos(2 * M_PI * 6367 * i / rate) * INT16_MAX / 3;
+
+		FILE *f = fopen(name, "w");
+		cr_assert((f != NULL), "Cannot create %s", name);
+		AUDIO_HEADER hdr = const_hdr;
+		hdr.sample_rate = rate;
+		hdr.data_size = m * sizeof(int16_t);
+		audio_write_header(f, &hdr);
+		audio_write_samples(f, wide, m);
+		fclose(f);
+
+		// The events must be those found at 8000 samples per second, with their
+		// indices scaled to the higher rate.
+		char *expected;
+		size_t expected_len;
+		FILE *out = open_memstream(&expected, &expected_len);
+		FILE *in = fmemopen(reference, strlen(reference), "r");
+		unsigned int start, end;
+		char symbol;
+		while (fscanf(in, "%u\t%u\t%c\n", &start, &end, &symbol) == 3)
+			fprintf(out, "%u\t%u\t%c\n", (unsigned int)((uint64_t)start * rate / AUDIO_FRAME_RATE),
+				(unsigned int)((uint64_t)end * rate / AUDIO_FRAME_RATE), symbol);
+		fclose(in);
+		fclose(out);
+
+		// Whether the file is mapped or read as a stream.
+		for (int mode = 0; mode < 2; mode++) {
+			char *text;
+			size_t text_len;
+			out = open_memstream(&text, &text_len);
+			f = fopen(name, "r");
+			cr_assert((f != NULL), "Cannot open %s", name);
+			int ret;
+			block_size = 100;
+			if (mode == 0) {
+				ret = dtmf_detect(f, out);
+			} else {
+				AUDIO_HEADER header;
+				cr_assert((audio_read_header(f, &header) == 0), "Header rejected");
+				DTMF_DETECTOR *dp = dtmf_detector_create(100, header.sample_rate, out);
+				cr_assert((dp != NULL), "Rate %u rejected", rate);
+				ret = dtmf_detector_run(dp, f);
+				dtmf_detector_destroy(dp);
+			}
+			fclose(f);
+			fclose(out);
+			cr_assert((ret == 0), "Detection failed at %u in mode %d", rate, mode);
+			cr_assert((strcmp(text, expected) == 0),
+				  "Output at %u in mode %d differs:\n%s\nExpected:\n%s",
+				  rate, mode, text, expected);
+			free(text);
+		}
+		free(expected);
+		free(wide);
+	}
+	free(reference);
+	free(samples);
+}
+
+/*
+ * The lines of event text that begin with a given channel number, without it.
+ */
+static char *channel_lines(char *text, int channel)
+{
+	char *lines;
+	size_t len;
+	FILE *out = open_memstream(&lines, &len);
+	char prefix[16];
+	snprintf(prefix, sizeof(prefix), "%d\t", channel);
+	for (char *line = text; *line; ) {
+		char *next = strchr(line, '\n');
+		next = next ? next + 1 : line + strlen(line);
+		if (strncmp(line, prefix, strlen(prefix)) == 0)
+			fwrite(line + strlen(prefix), 1, next - line - strlen(prefix), out);
+		line = next;
+	}
+	fclose(out);
+	return lines;
+}
+
+Test(detector_suite, stereo_channels, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+
+	// The tones on the left, and only those in the second half on the right.
+	int16_t *right = calloc(n, sizeof(int16_t));
+	int16_t *frames = malloc(2 * n * sizeof(int16_t));
+	cr_assert((right != NULL && frames != NULL), "Cannot malloc sample buffers");
+	for (size_t i = n / 2; i < n; i++)
+		right[i] = samples[i];
+	for (size_t i = 0; i < n; i++) {
+		frames[2 * i] = samples[i];
+		frames[2 * i + 1] = right[i];
+	}
+	char *expected[2] = {reference_output(samples, n, 100), reference_output(right, n, 100)};
+
+	const char *name = "hw1-test-output/stereo.au";
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+	FILE *f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create %s", name);
+	AUDIO_HEADER hdr = const_hdr;
+	hdr.channels = 2;
+	hdr.data_size = 2 * n * sizeof(int16_t);
+	audio_write_header(f, &hdr);
+	audio_write_samples(f, frames, 2 * n);
+	fclose(f);
+
+	// Each channel must have the events found in it alone, whether the file is
+	// mapped, read as a stream or given to dtmf_detect_parallel().
+	for (int mode = 0; mode < 3; mode++) {
+		char *text;
+		size_t text_len;
+		FILE *out = open_memstream(&text, &text_len);
+		f = fopen(name, "r");
+		cr_assert((f != NULL), "Cannot open %s", name);
+		int ret;
+		block_size = 100;
+		if (mode == 0) {
+			ret = dtmf_detect(f, out);
+		} else if (mode == 1) {
+			AUDIO_HEADER header;
+			cr_assert((audio_read_header(f, &header) == 0), "Header rejected");
+			DTMF_CHANNELS *cp = dtmf_channels_create(100, header.sample_rate,
+								 header.channels, out);
+			cr_assert((cp != NULL), "Channels rejected");
+			ret = dtmf_channels_run(cp, f);
+			dtmf_channels_destroy(cp);
+		} else {
+			ret = dtmf_detect_parallel(f, out, 3, 100, 0);
+		}
+		fclose(f);
+		fclose(out);
+		cr_assert((ret == 0), "Detection failed in mode %d", mode);
+		for (int c = 0; c < 2; c++) {
+			char *lines = channel_lines(text, c);
+			cr_assert((strcmp(lines, expected[c]) == 0),
+				  "Channel %d in mode %d differs:\n%s\nExpected:\n%s",
+				  c, mode, lines, expected[c]);
+			free(lines);
+		}
+		free(text);
+	}
+	free(expected[0]);
+	free(expected[1]);
+	free(frames);
+	free(right);
+	free(samples);
+}
+
+Test(detector_suite, refined_boundaries, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	// Blocks of 400 samples, refined with blocks of 100, find the same boundaries
+	// as blocks of 100 (the 100-sample 'D' is too short for either to detect).
+	char *expected = reference_output(samples, n, 100);
+	for (int fixed = 0; fixed < 2; fixed++) {
+		char *text;
+		size_t len;
+		FILE *out = open_memstream(&text, &len);
+		DTMF_DETECTOR *dp = dtmf_detector_create(400, AUDIO_FRAME_RATE, out);
+		cr_assert((dp != NULL), "Cannot create detector");
+		cr_assert_eq(dtmf_detector_set_refine(dp, 400), EOF, "Fine block as large as coarse accepted");
+		cr_assert_eq(dtmf_detector_set_refine(dp, 50), EOF, "Fine block too small to resolve accepted");
+		cr_assert_eq(dtmf_detector_set_refine(dp, 100), 0, "Cannot select refinement");
+		cr_assert_eq(dtmf_detector_set_fixed(dp, fixed), 0, "Cannot select fixed point");
+		for (size_t i = 0; i < n; i += 333) {
+			size_t count = n - i < 333 ? n - i : 333;
+			dtmf_detector_feed(dp, samples + i, count);
+		}
+		dtmf_detector_finish(dp);
+		dtmf_detector_destroy(dp);
+		fclose(out);
+		cr_assert((strcmp(text, expected) == 0),
+			  "Refined output (fixed %d) differs:\n%s\nExpected:\n%s\n",
+			  fixed, text, expected);
+		free(text);
+	}
+	free(expected);
+	free(samples);
+}
+
+Test(detector_suite, trace_blocks, .timeout=10)
+{
+	size_t n;
+	int16_t *samples = make_samples(1000, &n);
+	const char *names[] = {"hw1-test-output/trace.bin", "hw1-test-output/trace.csv"};
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+	for (int csv = 0; csv < 2; csv++) {
+		DTMF_TRACE *tp = dtmf_trace_open((char *)names[csv], 100);
+		cr_assert((tp != NULL), "Cannot create %s", names[csv]);
+		DTMF_DETECTOR *dp = dtmf_detector_create(100, AUDIO_FRAME_RATE, NULL);
+		cr_assert((dp != NULL), "Cannot create detector");
+		dtmf_detector_set_trace(dp, tp, 3);
+		dtmf_detector_feed(dp, samples, n);
+		dtmf_detector_finish(dp);
+		uint32_t blocks = dp->blocks;
+		dtmf_detector_destroy(dp);
+		cr_assert_eq(dtmf_trace_close(tp), 0, "Error writing %s", names[csv]);
+
+		FILE *f = fopen(names[csv], "r");
+		cr_assert((f != NULL), "Cannot open %s", names[csv]);
+		uint32_t records = 0, accepted = 0, silent = 0;
+		if (csv) {
+			char line[512], symbol[4], reason[16];
+			unsigned index, channel;
+			cr_assert((fgets(line, sizeof(line), f) != NULL), "No header line");
+			while (fgets(line, sizeof(line), f)) {
+				// The symbol is empty unless one was found.
+				char *p = strrchr(line, ',');
+				cr_assert((p != NULL && sscanf(p + 1, "%15s", reason) == 1),
+					  "Bad line %s", line);
+				cr_assert_eq(sscanf(line, "%u,%u,", &index, &channel), 2, "Bad line %s", line);
+				cr_assert_eq(index, 100 * records, "Wrong index in %s", line);
+				cr_assert_eq(channel, 3, "Wrong channel in %s", line);
+				accepted += !strcmp(reason, "ok");
+				silent += !strcmp(reason, "silent");
+				records++;
+			}
+		} else {
+			DTMF_TRACE_HEADER header;
+			DTMF_TRACE_BLOCK b;
+			cr_assert_eq(fread(&header, sizeof(header), 1, f), 1, "No header");
+			cr_assert((memcmp(header.magic, DTMF_TRACE_MAGIC, 8) == 0), "Wrong magic");
+			cr_assert_eq(header.record_size, sizeof(b), "Wrong record size");
+			while (fread(&b, sizeof(b), 1, f) == 1) {
+				cr_assert_eq(b.index, 100 * records, "Wrong index %u", b.index);
+				cr_assert_eq(b.symbol == 0, b.reason != DTMF_BLOCK_ACCEPTED,
+					     "Symbol and outcome disagree at %u", b.index);
+				cr_assert_eq(b.symbol, dtmf_block_symbol(b.strengths),
+					     "Traced symbol does not match strengths at %u", b.index);
+				accepted += b.reason == DTMF_BLOCK_ACCEPTED;
+				silent += b.reason == DTMF_BLOCK_SILENT;
+				records++;
+			}
+		}
+		fclose(f);
+		cr_assert_eq(records, blocks, "%u blocks traced of %u", records, blocks);
+		// Every block of each tone is accepted, even that of the 'D', whose event is
+		// too short to be reported.
+		cr_assert_eq(accepted, 56, "%u blocks accepted", accepted);
+		cr_assert((silent > 0), "No silent blocks");
+	}
+	free(samples);
+}
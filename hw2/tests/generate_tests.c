@@ -1,4 +1,8 @@
 #include "test_common.h"
+#include "dtmf_synth.h"
+#include "audio_noise.h"
+#include "dtmf_events.h"
+#include "dtmf_parallel.h"
 
 struct _test_context {
 	int duration;
@@ -290,3 +294,169 @@ Test(generate_suite, short_noise, .timeout=10)
 	unlink(noise_file_name);
 	cleanup_test(&ctx);
 }
+
+Test(generate_suite, synth_accuracy, .timeout=10)
+{
+	// Compare the oscillators with cos() for every symbol, over an odd-length
+	// stretch that starts far into a long file.
+	const uint32_t start = 480001, n = 8000 + 3;
+	double *samples = malloc(n * sizeof(double));
+	cr_assert((samples != NULL), "Cannot malloc sample buffer");
+
+	double max_error = 0;
+	for (int r = 0; r < NUM_DTMF_ROW_FREQS; r++) {
+		for (int c = 0; c < NUM_DTMF_COL_FREQS; c++) {
+			double w_row = 2.0*M_PI*dtmf_freqs[r]/AUDIO_FRAME_RATE;
+			double w_col = 2.0*M_PI*dtmf_freqs[NUM_DTMF_ROW_FREQS + c]/AUDIO_FRAME_RATE;
+			dtmf_synth_span(w_row, w_col, start, n, samples);
+			for (uint32_t k = 0; k < n; k++) {
+				uint32_t i = start + k;
+				double ref = (cos(w_row*i)*0.5 + cos(w_col*i)*0.5) * INT16_MAX;
+				double error = fabs(samples[k] - ref);
+				if (error > max_error)
+					max_error = error;
+			}
+		}
+	}
+	cr_log_info("Maximum synthesis error: %g\n", max_error);
+	cr_assert((max_error < 1e-4),
+		  "Synthesized samples differ from cos() by %g", max_error);
+	free(samples);
+}
+
+Test(generate_suite, synth_tables, .timeout=10)
+{
+	// The table of each symbol must hold a whole period, whose samples are those
+	// of cos() at any index with the same remainder.
+	for (int r = 0; r < NUM_DTMF_ROW_FREQS; r++) {
+		for (int c = 0; c < NUM_DTMF_COL_FREQS; c++) {
+			uint32_t period = 0;
+			int16_t *table = dtmf_synth_table(r, c, &period);
+			cr_assert((table != NULL), "No table for row %d, column %d", r, c);
+			cr_assert((period > 0 && AUDIO_FRAME_RATE % period == 0),
+				  "Period %u does not divide the frame rate", period);
+			double w_row = 2.0*M_PI*dtmf_freqs[r]/AUDIO_FRAME_RATE;
+			double w_col = 2.0*M_PI*dtmf_freqs[NUM_DTMF_ROW_FREQS + c]/AUDIO_FRAME_RATE;
+			for (uint32_t i = 480001; i < 480001 + 3 * period; i++) {
+				double ref = (cos(w_row*i)*0.5 + cos(w_col*i)*0.5) * INT16_MAX;
+				int16_t sample = table[i % period];
+				cr_assert((fabs(sample - ref) < 1.0001),
+					  "Row %d, column %d, sample %u is %d, not %g",
+					  r, c, i, sample, ref);
+			}
+			uint32_t again;
+			cr_assert((dtmf_synth_table(r, c, &again) == table && again == period),
+				  "Table for row %d, column %d built twice", r, c);
+		}
+	}
+}
+
+Test(generate_suite, noise_reuse, .timeout=10)
+{
+	char *noise_file_name = "randnoise4.au";
+	const size_t noise_data_len =
+	    sizeof(AUDIO_HEADER) +
+	    1000 * AUDIO_FRAME_RATE / 1000 * sizeof(int16_t);
+	char noise_data[noise_data_len];
+	generate_noise_file(noise_file_name, noise_data, 1000);
+
+	AUDIO_NOISE *np = audio_noise_open(noise_file_name);
+	cr_assert((np != NULL), "Cannot open noise file");
+	cr_assert((np->nsamples == AUDIO_FRAME_RATE),
+		  "Wrong number of noise samples (%zu)", np->nsamples);
+	audio_noise_close(np);
+	cr_assert((audio_noise_open(noise_file_name) == np),
+		  "Noise from an unchanged file was not reused");
+	audio_noise_close(np);
+
+	// A file that has been rewritten must be read again.
+	generate_noise_file(noise_file_name, noise_data, 500);
+	np = audio_noise_open(noise_file_name);
+	cr_assert((np != NULL), "Cannot open noise file");
+	cr_assert((np->nsamples == AUDIO_FRAME_RATE / 2),
+		  "Stale noise samples were reused (%zu)", np->nsamples);
+	audio_noise_close(np);
+
+	unlink(noise_file_name);
+	cr_assert((audio_noise_open(noise_file_name) == NULL),
+		  "Missing noise file was not reported");
+}
+
+Test(generate_suite, many_events, .timeout=10)
+{
+	// More events than are parsed in one chunk, some of them adjacent.
+	const int n = 3 * DTMF_EVENT_CHUNK + 7;
+	const char *symbols = "0123456789ABCD*#";
+	struct _dtmf_event *events = malloc(n * sizeof(*events));
+	cr_assert((events != NULL), "Cannot malloc events");
+	uint32_t start = 3;
+	for (int e = 0; e < n; e++) {
+		events[e].start_index = start;
+		events[e].end_index = start + 20 + e % 7;
+		events[e].symbol = symbols[e % 16];
+		start = events[e].end_index + (e % 3 ? 5 : 0);
+	}
+
+	struct _test_context ctx;
+	setup_test(&ctx, events, n, (start + 7999) / 8000 * 1000, 32 * n);
+
+	int ret = dtmf_generate(ctx.fin, ctx.fout, ctx.nsamples);
+	cr_assert((ret == 0),
+		  "Failed to write audio file in dtmf_generate (%d)", ret);
+	fflush(ctx.fout);
+
+	validate_dtmf_audio(events, n, ctx.output,
+			    ctx.expected_output_len, NULL, 0);
+
+	cleanup_test(&ctx);
+	free(events);
+}
+
+Test(generate_suite, parallel_matches_serial, .timeout=10)
+{
+	struct _dtmf_event events[] = {{100, 900, '5'},
+				       {1000, 8200, '6'},
+				       {8200, 9000, 'A'},
+				       {12000, 16400, '#'},
+				       {20000, 24000, '*'}};
+
+	char *noise_file_name = "randnoise5.au";
+	const size_t noise_data_len =
+	    sizeof(AUDIO_HEADER) +
+	    1000 * AUDIO_FRAME_RATE / 1000 * sizeof(int16_t);
+	char noise_data[noise_data_len];
+	generate_noise_file(noise_file_name, noise_data, 1000);
+	noise_file = noise_file_name;
+	noise_level = 5;
+
+	struct _test_context ctx;
+	setup_test(&ctx, events, nelem(events), 3000, 4096);
+	int ret = dtmf_generate(ctx.fin, ctx.fout, ctx.nsamples);
+	cr_assert((ret == 0),
+		  "Failed to write audio file in dtmf_generate (%d)", ret);
+	fflush(ctx.fout);
+
+	// The same events again, generated by three threads into a file.
+	rewind(ctx.fin);
+	FILE *f = tmpfile();
+	cr_assert((f != NULL), "Cannot create temporary file");
+	ret = dtmf_generate_parallel(ctx.fin, f, ctx.nsamples, 3);
+	cr_assert((ret == 0),
+		  "Failed to write audio file in dtmf_generate_parallel (%d)", ret);
+	cr_assert((ftell(f) == (long)ctx.expected_output_len),
+		  "File position %ld is not at the end of the audio", ftell(f));
+
+	char *output = malloc(ctx.expected_output_len);
+	cr_assert((output != NULL), "Cannot malloc output buffer");
+	rewind(f);
+	cr_assert((fread(output, 1, ctx.expected_output_len, f) == ctx.expected_output_len),
+		  "Parallel output is too short");
+	cr_assert((memcmp(output, ctx.output, ctx.expected_output_len) == 0),
+		  "Parallel output differs from serial output");
+
+	free(output);
+	fclose(f);
+	unlink(noise_file_name);
+	noise_file = NULL;
+	cleanup_test(&ctx);
+}
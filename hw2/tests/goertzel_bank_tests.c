@@ -0,0 +1,209 @@
+#include "test_common.h"
+#include "audio_bulk.h"
+#include "goertzel_bank.h"
+#include "goertzel_fixed.h"
+
+static void fill_samples(int16_t *samples, int n)
+{
+	// Deterministic pseudo-random signal with a DTMF tone on top.
+	uint32_t seed = 12345;
+	for (int i = 0; i < n; i++) {
+		seed = seed * 1103515245 + 12345;
+		double noise = ((int)(seed >> 16) % 2000 - 1000) / 1000.0;
+		double tone = cos(2 * M_PI * 770 * i / AUDIO_FRAME_RATE) +
+			      cos(2 * M_PI * 1477 * i / AUDIO_FRAME_RATE);
+		samples[i] = (int16_t)((0.3 * noise + 0.3 * tone) * INT16_MAX);
+	}
+}
+
+static void check_bank_block(int block_size)
+{
+	int16_t samples[block_size];
+	fill_samples(samples, block_size);
+
+	GOERTZEL_STATE ref[NUM_DTMF_FREQS];
+	double ref_res[NUM_DTMF_FREQS];
+	for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+		double k = dtmf_freqs[f] / 8000.0 * block_size;
+		goertzel_init(&ref[f], block_size, k);
+		for (int i = 0; i < block_size - 1; i++)
+			goertzel_step(&ref[f], 1.0 * samples[i] / INT16_MAX);
+		ref_res[f] = goertzel_strength(&ref[f],
+					       1.0 * samples[block_size - 1] / INT16_MAX);
+	}
+
+	double x[block_size];
+	audio_normalize_samples(samples, x, block_size);
+
+	DTMF_PLAN *plan = dtmf_plan_create(block_size, AUDIO_FRAME_RATE, dtmf_freqs);
+	GOERTZEL_BANK bank;
+	double bank_res[NUM_DTMF_FREQS];
+	goertzel_bank_init(&bank, plan);
+	goertzel_bank_block(&bank, x, bank_res);
+	dtmf_plan_destroy(plan);
+
+	for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+		cr_assert_eq(bank_res[f], ref_res[f],
+			     "Bank strength for %dHz (block %d) differs: %.17g != %.17g",
+			     dtmf_freqs[f], block_size, bank_res[f], ref_res[f]);
+	}
+}
+
+Test(goertzel_bank_suite, matches_separate_filters, .timeout=10)
+{
+	int sizes[] = {10, 99, 100, 205, 1000};
+	for (int i = 0; i < nelem(sizes); i++)
+		check_bank_block(sizes[i]);
+}
+
+Test(goertzel_bank_suite, reused_bank, .timeout=10)
+{
+	// Running the same block twice through a bank must give the same result,
+	// i.e. goertzel_bank_block() must start each block from a clean state.
+	const int block_size = 160;
+	int16_t samples[block_size];
+	fill_samples(samples, block_size);
+
+	double x[block_size];
+	audio_normalize_samples(samples, x, block_size);
+
+	GOERTZEL_BANK bank;
+	double first[NUM_DTMF_FREQS], second[NUM_DTMF_FREQS];
+	goertzel_bank_init(&bank, dtmf_plan_get(block_size, AUDIO_FRAME_RATE, dtmf_freqs));
+	goertzel_bank_block(&bank, x, first);
+	goertzel_bank_block(&bank, x, second);
+	for (int f = 0; f < NUM_DTMF_FREQS; f++)
+		cr_assert_eq(first[f], second[f], "Strengths differ on reuse of bank");
+}
+
+Test(goertzel_bank_suite, plan_cache, .timeout=10)
+{
+	DTMF_PLAN *p1 = dtmf_plan_get(205, AUDIO_FRAME_RATE, dtmf_freqs);
+	DTMF_PLAN *p2 = dtmf_plan_get(100, AUDIO_FRAME_RATE, dtmf_freqs);
+	DTMF_PLAN *p3 = dtmf_plan_get(205, AUDIO_FRAME_RATE, dtmf_freqs);
+	cr_assert((p1 != NULL && p2 != NULL), "Plan could not be created");
+	cr_assert((p1 == p3), "Plan for the same parameters was not reused");
+	cr_assert((p1 != p2), "Plan for a different block size was reused");
+	cr_assert_eq(p1->N, 205, "Wrong block size in plan (%u)", p1->N);
+	dtmf_plan_cache_clear();
+}
+
+Test(goertzel_bank_suite, specialized_kernels, .timeout=10)
+{
+	// The common block sizes must get a kernel, which must give exactly the
+	// strengths of the generic loop; other sizes and rates must not.
+	int sizes[] = {100, 160, 205, 256};
+	int16_t samples[256];
+	double x[256];
+	fill_samples(samples, 256);
+	audio_normalize_samples(samples, x, 256);
+	for (int i = 0; i < nelem(sizes); i++) {
+		DTMF_PLAN *plan = dtmf_plan_create(sizes[i], AUDIO_FRAME_RATE, dtmf_freqs);
+		cr_assert((plan->bank_kernel != NULL), "No kernel for block size %d", sizes[i]);
+		GOERTZEL_BANK bank;
+		double fast[NUM_DTMF_FREQS], slow[NUM_DTMF_FREQS];
+		goertzel_bank_init(&bank, plan);
+		goertzel_bank_block(&bank, x, fast);
+		plan->bank_kernel = NULL;
+		goertzel_bank_block(&bank, x, slow);
+		for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+			cr_assert_eq(fast[f], slow[f],
+				     "Kernel strength for %dHz (block %d) differs: %.17g != %.17g",
+				     dtmf_freqs[f], sizes[i], fast[f], slow[f]);
+		}
+		dtmf_plan_destroy(plan);
+	}
+	DTMF_PLAN *plan = dtmf_plan_create(101, AUDIO_FRAME_RATE, dtmf_freqs);
+	cr_assert((plan->bank_kernel == NULL), "Kernel chosen for block size 101");
+	dtmf_plan_destroy(plan);
+	plan = dtmf_plan_create(205, 16000, dtmf_freqs);
+	cr_assert((plan->bank_kernel == NULL), "Kernel chosen for a rate of 16000");
+	dtmf_plan_destroy(plan);
+}
+
+Test(goertzel_bank_suite, sliding_matches_blocks, .timeout=10)
+{
+	// The sliding bank, moved one sample at a time over a long signal, must agree
+	// closely with the bank run over each window separately.
+	int block_size = 205, total = 4000;
+	int16_t samples[total];
+	fill_samples(samples, total);
+	double x[total];
+	audio_normalize_samples(samples, x, total);
+
+	DTMF_PLAN *plan = dtmf_plan_create(block_size, AUDIO_FRAME_RATE, dtmf_freqs);
+	GOERTZEL_BANK bank;
+	GOERTZEL_SLIDE slide;
+	goertzel_bank_init(&bank, plan);
+	goertzel_slide_init(&slide, plan);
+	goertzel_slide_step(&slide, x, NULL, block_size);
+	for (int end = block_size; end <= total; end++) {
+		if (end > block_size)
+			goertzel_slide_step(&slide, x + end - 1, x + end - 1 - block_size, 1);
+		double slide_res[NUM_DTMF_FREQS], bank_res[NUM_DTMF_FREQS];
+		goertzel_slide_strengths(&slide, slide_res);
+		goertzel_bank_block(&bank, x + end - block_size, bank_res);
+		for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+			cr_assert((fabs(slide_res[f] - bank_res[f]) < 1e-9),
+				  "Window ending at %d, %dHz: %lf != %lf",
+				  end, dtmf_freqs[f], slide_res[f], bank_res[f]);
+		}
+	}
+	dtmf_plan_destroy(plan);
+}
+
+static void check_fixed_block(int16_t *samples, int block_size)
+{
+	double x[block_size];
+	audio_normalize_samples(samples, x, block_size);
+	DTMF_PLAN *plan = dtmf_plan_create(block_size, AUDIO_FRAME_RATE, dtmf_freqs);
+	GOERTZEL_BANK bank;
+	double bank_res[NUM_DTMF_FREQS], fixed_res[NUM_DTMF_FREQS];
+	goertzel_bank_init(&bank, plan);
+	goertzel_bank_block(&bank, x, bank_res);
+	goertzel_fixed_block(plan, samples, fixed_res);
+	dtmf_plan_destroy(plan);
+
+	double max = 0;
+	for (int f = 0; f < NUM_DTMF_FREQS; f++)
+		max = fmax(max, bank_res[f]);
+	for (int f = 0; f < NUM_DTMF_FREQS; f++) {
+		cr_assert((fabs(fixed_res[f] - bank_res[f]) <= 1e-3 * max),
+			  "Fixed-point strength for %dHz (block %d) differs: %.17g != %.17g",
+			  dtmf_freqs[f], block_size, fixed_res[f], bank_res[f]);
+	}
+}
+
+Test(goertzel_bank_suite, fixed_matches_float, .timeout=10)
+{
+	int sizes[] = {10, 99, 100, 205, 1000};
+	for (int i = 0; i < nelem(sizes); i++) {
+		int16_t samples[sizes[i]];
+		fill_samples(samples, sizes[i]);
+		check_fixed_block(samples, sizes[i]);
+	}
+}
+
+Test(goertzel_bank_suite, fixed_full_scale, .timeout=10)
+{
+	// A full-scale square wave at the lowest DTMF frequency drives the state
+	// of that filter as high as it can go in the largest block.
+	int block_size = 1000;
+	int16_t samples[block_size];
+	for (int i = 0; i < block_size; i++)
+		samples[i] = cos(2 * M_PI * 697 * i / AUDIO_FRAME_RATE) >= 0 ? INT16_MAX : INT16_MIN;
+	check_fixed_block(samples, block_size);
+}
+
+Test(goertzel_bank_suite, fixed_energy, .timeout=10)
+{
+	int n = 1001;
+	int16_t samples[n];
+	fill_samples(samples, n);
+	samples[0] = INT16_MIN;
+	double x[n];
+	audio_normalize_samples(samples, x, n);
+	double fixed = goertzel_fixed_energy(samples, n);
+	double bank = goertzel_bank_energy(x, n);
+	cr_assert((fabs(fixed - bank) < 1e-9 * bank), "Energy differs: %.17g != %.17g", fixed, bank);
+}
@@ -0,0 +1,83 @@
+#include "test_common.h"
+#include "dtmf_detector.h"
+#include "tone_bank.h"
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define TONES_FILE "tests/rsrc/tones.txt"
+
+Test(tone_bank_suite, load_description, .timeout=10)
+{
+	TONE_SPEC *sp = tone_spec_load(TONES_FILE);
+	cr_assert((sp != NULL), "Cannot load %s", TONES_FILE);
+	cr_assert_eq(sp->block_size, 200, "Wrong block size %u", sp->block_size);
+	cr_assert_eq(sp->nfamilies, 2, "Wrong number of families %d", sp->nfamilies);
+	cr_assert_eq(sp->ntones, 5, "Wrong number of tones %d", sp->ntones);
+	// 440 Hz is shared by dial tone and ringback.
+	cr_assert_eq(sp->nfreqs, 6, "Wrong number of frequencies %d", sp->nfreqs);
+	cr_assert(!strcmp(sp->tones[4].name, "CED") && sp->tones[4].nfreqs == 1 &&
+		  sp->tones[4].min_ms == 1000 && sp->tones[4].family == 1,
+		  "CED tone not described correctly");
+	tone_spec_free(sp);
+
+	const char *name = "hw1-test-output/bad_tones.txt";
+	if (access("hw1-test-output", F_OK) == -1)
+		mkdir("hw1-test-output", 0755);
+	FILE *f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create %s", name);
+	fprintf(f, "# A tone outside any family.\ntone dial 350 440 1000\n");
+	fclose(f);
+	cr_assert((tone_spec_load((char *)name) == NULL), "Invalid description accepted");
+
+	f = fopen(name, "w");
+	cr_assert((f != NULL), "Cannot create %s", name);
+	fprintf(f, "family cpt twist 8 margin 6 level -30\ntone high 5000 100\n");
+	fclose(f);
+	cr_assert((tone_spec_load((char *)name) == NULL), "Frequency above 4000 Hz accepted");
+}
+
+Test(tone_bank_suite, tones_with_dtmf, .timeout=10)
+{
+	// Dial tone, busy tone, fax calling tone and a DTMF symbol in turn.
+	static const struct {
+		uint32_t start, end;
+		int f1, f2;
+	} bursts[] = {{0, 12000, 350, 440}, {16000, 20000, 480, 620},
+		      {24000, 28000, 1100, 0}, {30000, 32000, 770, 1336}};
+	size_t n = 36000;
+	int16_t *samples = calloc(n, sizeof(int16_t));
+	cr_assert((samples != NULL), "Cannot malloc sample buffer");
+	for (int b = 0; b < nelem(bursts); b++) {
+		for (uint32_t i = bursts[b].start; i < bursts[b].end; i++) {
+			double x = cos(2 * M_PI * bursts[b].f1 * i / AUDIO_FRAME_RATE);
+			if (bursts[b].f2)
+				x += cos(2 * M_PI * bursts[b].f2 * i / AUDIO_FRAME_RATE);
+			samples[i] = x * INT16_MAX / 4;
+		}
+	}
+
+	TONE_SPEC *sp = tone_spec_load(TONES_FILE);
+	cr_assert((sp != NULL), "Cannot load %s", TONES_FILE);
+	char *text;
+	size_t text_len;
+	FILE *out = open_memstream(&text, &text_len);
+	DTMF_DETECTOR *dp = dtmf_detector_create(100, AUDIO_FRAME_RATE, out);
+	cr_assert((dtmf_detector_set_tones(dp, sp) == 0), "Cannot attach tone bank");
+	// Fed in pieces that do not match the blocks of either bank.
+	for (size_t i = 0; i < n; i += 1234)
+		dtmf_detector_feed(dp, samples + i, n - i < 1234 ? n - i : 1234);
+	dtmf_detector_finish(dp);
+	dtmf_detector_destroy(dp);
+	fclose(out);
+
+	const char *expected = "0\t12000\tdial\n"
+			       "16000\t20000\tbusy\n"
+			       "24000\t28000\tCNG\n"
+			       "30000\t32000\t5\n";
+	cr_assert((strcmp(text, expected) == 0), "Output differs:\n%s\nExpected:\n%s",
+		  text, expected);
+	free(text);
+	free(samples);
+	tone_spec_free(sp);
+}
@@ -2,6 +2,7 @@
 #include <criterion/logging.h>
 #include <string.h>
 #include "const.h"
+#include "dtmf_options.h"
 
 #define FLAG_BITS 0x7
 
@@ -189,3 +190,180 @@ Test(validargs_suite, dtmf_illegal_flags, .timeout=10) {
     cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
 		 ret, exp_ret);
 }
+
+/* bin/dtmf -d --batch list_file -j 4 -b 205 */
+Test(validargs_suite, dtmf_d_batch_j, .timeout=10) {
+    char *list_file_exp = "files.txt";
+    char *argv[] = {"bin/dtmf", "-d", "--batch", list_file_exp, "-j", "4", "-b", "205", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    int flag = 0x4;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(global_options & FLAG_BITS, flag, "Correct bit (0x%x) not set for -d. Got: %x",
+		 flag, global_options);
+    cr_assert(!strcmp(batch_file, list_file_exp),
+	      "Variable 'batch_file' was not properly set.  Got: %s | Expected: %s",
+	      batch_file, list_file_exp);
+    cr_assert_eq(num_jobs, 4, "Correct num_jobs (4) not set for -j. Got: %d", num_jobs);
+    cr_assert_eq(block_size, 205, "Correct block_size (205) not set for -b. Got: %d", block_size);
+}
+
+/* bin/dtmf -d -j 0 --batch list_file */
+Test(validargs_suite, dtmf_d_batch_invalidJobs, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-j", "0", "--batch", "files.txt", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d -s 10 -b 205 */
+Test(validargs_suite, dtmf_d_hop, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-s", "10", "-b", "205", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(hop_size, 10, "Correct hop_size (10) not set for -s. Got: %d", hop_size);
+    cr_assert_eq(block_size, 205, "Correct block_size (205) not set for -b. Got: %d", block_size);
+}
+
+/* bin/dtmf -d -b 100 -s 101 */
+Test(validargs_suite, dtmf_d_hop_larger_than_block, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-b", "100", "-s", "101", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d -b 400 -r 100 */
+Test(validargs_suite, dtmf_d_refine, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-b", "400", "-r", "100", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(refine_size, 100, "Correct refine_size (100) not set for -r. Got: %d", refine_size);
+    cr_assert_eq(block_size, 400, "Correct block_size (400) not set for -b. Got: %d", block_size);
+}
+
+/* bin/dtmf -d -r 100 */
+Test(validargs_suite, dtmf_d_refine_not_smaller, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-r", "100", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d -b 400 -r 50 */
+Test(validargs_suite, dtmf_d_refine_too_small, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "-b", "400", "-r", "50", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d --queue 8 */
+Test(validargs_suite, dtmf_d_queue, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "--queue", "8", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(queue_depth, 8, "Correct queue_depth (8) not set for --queue. Got: %d", queue_depth);
+}
+
+/* bin/dtmf -d --queue 1 */
+Test(validargs_suite, dtmf_d_queue_too_shallow, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "--queue", "1", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d --fixed -b 205 */
+Test(validargs_suite, dtmf_d_fixed, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-d", "--fixed", "-b", "205", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(fixed_point, 1, "fixed_point not set for --fixed. Got: %d", fixed_point);
+    cr_assert_eq(block_size, 205, "Correct block_size (205) not set for -b. Got: %d", block_size);
+}
+
+/* bin/dtmf -g -j 4 -t 2000 */
+Test(validargs_suite, dtmf_g_j, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-g", "-j", "4", "-t", "2000", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    int flag = 0x2;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert_eq(global_options & FLAG_BITS, flag, "Correct bit (0x%x) not set for -g. Got: %x",
+		 flag, global_options);
+    cr_assert_eq(num_jobs, 4, "Correct num_jobs (4) not set for -j. Got: %d", num_jobs);
+    cr_assert_eq(audio_samples, 16000, "Correct audio_samples (16000) not set for -t. Got: %d",
+		 audio_samples);
+}
+
+/* bin/dtmf -g -j 65 */
+Test(validargs_suite, dtmf_g_invalidJobs, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-g", "-j", "65", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -g -jzz 2 */
+Test(validargs_suite, dtmf_g_jobs_misspelled, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-g", "-jzz", "2", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}
+
+/* bin/dtmf -d --tones tones.txt -b 160 */
+Test(validargs_suite, dtmf_d_tones, .timeout=10) {
+    char *tones_file_exp = "tones.txt";
+    char *argv[] = {"bin/dtmf", "-d", "--tones", tones_file_exp, "-b", "160", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = 0;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+    cr_assert(tones_file && !strcmp(tones_file, tones_file_exp),
+	      "Variable 'tones_file' was not properly set.  Got: %s | Expected: %s",
+	      tones_file, tones_file_exp);
+    cr_assert_eq(block_size, 160, "Correct block_size (160) not set for -b. Got: %d", block_size);
+}
+
+/* bin/dtmf -g --tones tones.txt */
+Test(validargs_suite, dtmf_g_tones, .timeout=10) {
+    char *argv[] = {"bin/dtmf", "-g", "--tones", "tones.txt", NULL};
+    int argc = sizeof(argv)/sizeof(char *) - 1;
+    int ret = validargs(argc, argv);
+    int exp_ret = -1;
+    cr_assert_eq(ret, exp_ret, "Invalid return for validargs.  Got: %d | Expected: %d",
+		 ret, exp_ret);
+}